@@ -0,0 +1,221 @@
+#pragma once
+
+#include "frozen_graph.h"
+#include "graph.h"
+#include "router.h"
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <optional>
+#include <queue>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+    // Answers routes with two Dijkstra searches at once: forward from the source along the edges
+    // and backward from the target against them. Every edge between the two searched areas offers
+    // a path, the lightest one is final once the tops of the two queues add up to its weight.
+    // Not thread-safe: BuildRoute reuses search buffers.
+    template <typename Weight>
+    class BidirectionalRouter final : public RouterEngine<Weight> {
+    private:
+        using Graph = DirectedWeightedGraph<Weight>;
+        using ArcId = typename FrozenGraph<Weight>::ArcId;
+
+    public:
+        using typename RouterEngine<Weight>::RouteInfo;
+        using typename RouterEngine<Weight>::WeightMatrix;
+
+        explicit BidirectionalRouter(const Graph& graph);
+
+        std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const override;
+
+        // One forward search per source, it stops once all the targets are settled
+        WeightMatrix BuildWeightMatrix(const std::vector<VertexId>& sources,
+            const std::vector<VertexId>& targets) const override;
+
+    private:
+        static constexpr Weight ZERO_WEIGHT{};
+        static constexpr Weight UNREACHABLE = std::numeric_limits<Weight>::max();
+        static constexpr EdgeId NO_EDGE = std::numeric_limits<EdgeId>::max();
+
+        using QueueItem = std::pair<Weight, VertexId>;
+        using Queue = std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<QueueItem>>;
+
+        // The forward side keeps the edge into a vertex, the backward side the edge out of it
+        struct SearchSide {
+            std::vector<Weight> weights;
+            std::vector<EdgeId> edges;
+            std::vector<VertexId> touched;
+        };
+
+        static void ResetSide(SearchSide& side);
+
+        const Graph& graph_;
+        const FrozenGraph<Weight> forward_graph_;
+        const FrozenGraph<Weight> backward_graph_;
+        mutable SearchSide forward_side_;
+        mutable SearchSide backward_side_;
+    };
+
+    template <typename Weight>
+    BidirectionalRouter<Weight>::BidirectionalRouter(const Graph& graph)
+        : graph_(graph)
+        , forward_graph_(graph)
+        , backward_graph_(graph, ArcDirection::BACKWARD) {
+        for (ArcId arc = 0; arc < forward_graph_.GetArcCount(); ++arc) {
+            if (forward_graph_.GetArcWeight(arc) < ZERO_WEIGHT) {
+                throw std::domain_error("Edges' weights should be non-negative");
+            }
+        }
+        const size_t vertex_count = graph.GetVertexCount();
+        for (SearchSide* side : { &forward_side_, &backward_side_ }) {
+            side->weights.assign(vertex_count, UNREACHABLE);
+            side->edges.assign(vertex_count, NO_EDGE);
+        }
+    }
+
+    template <typename Weight>
+    std::optional<typename BidirectionalRouter<Weight>::RouteInfo> BidirectionalRouter<Weight>::BuildRoute(
+        VertexId from, VertexId to) const {
+        const size_t vertex_count = graph_.GetVertexCount();
+        if (from >= vertex_count || to >= vertex_count) {
+            throw std::out_of_range("Vertex id is out of range");
+        }
+        ResetSide(forward_side_);
+        ResetSide(backward_side_);
+
+        Queue forward_queue;
+        Queue backward_queue;
+        forward_side_.weights[from] = ZERO_WEIGHT;
+        forward_side_.touched.push_back(from);
+        forward_queue.push({ ZERO_WEIGHT, from });
+        backward_side_.weights[to] = ZERO_WEIGHT;
+        backward_side_.touched.push_back(to);
+        backward_queue.push({ ZERO_WEIGHT, to });
+
+        // A vertex reached by both sides is a meeting candidate, the weights of both halves
+        // only go down, so checking it on every update catches the lightest one
+        Weight best_weight = from == to ? ZERO_WEIGHT : UNREACHABLE;
+        VertexId meeting_vertex = from;
+        while (!forward_queue.empty() && !backward_queue.empty()
+            && forward_queue.top().first + backward_queue.top().first < best_weight) {
+            const bool forward_turn = forward_queue.top().first <= backward_queue.top().first;
+            Queue& queue = forward_turn ? forward_queue : backward_queue;
+            SearchSide& side = forward_turn ? forward_side_ : backward_side_;
+            const SearchSide& other_side = forward_turn ? backward_side_ : forward_side_;
+            const FrozenGraph<Weight>& frozen_graph = forward_turn ? forward_graph_ : backward_graph_;
+            const auto [weight, vertex] = queue.top();
+            queue.pop();
+            if (weight > side.weights[vertex]) continue;
+            const auto [arcs_begin, arcs_end] = frozen_graph.GetArcs(vertex);
+            for (ArcId arc = arcs_begin; arc < arcs_end; ++arc) {
+                const VertexId vertex_to = frozen_graph.GetArcTarget(arc);
+                const Weight candidate_weight = weight + frozen_graph.GetArcWeight(arc);
+                if (candidate_weight >= side.weights[vertex_to]) continue;
+                if (side.weights[vertex_to] == UNREACHABLE) {
+                    side.touched.push_back(vertex_to);
+                }
+                side.weights[vertex_to] = candidate_weight;
+                side.edges[vertex_to] = frozen_graph.GetArcEdgeId(arc);
+                queue.push({ candidate_weight, vertex_to });
+                if (other_side.weights[vertex_to] != UNREACHABLE
+                    && candidate_weight + other_side.weights[vertex_to] < best_weight) {
+                    best_weight = candidate_weight + other_side.weights[vertex_to];
+                    meeting_vertex = vertex_to;
+                }
+            }
+        }
+        if (best_weight == UNREACHABLE) {
+            return std::nullopt;
+        }
+
+        std::vector<EdgeId> edges;
+        for (EdgeId edge_id = forward_side_.edges[meeting_vertex]; edge_id != NO_EDGE;
+            edge_id = forward_side_.edges[graph_.GetEdge(edge_id).from]) {
+            edges.push_back(edge_id);
+        }
+        std::reverse(edges.begin(), edges.end());
+        for (EdgeId edge_id = backward_side_.edges[meeting_vertex]; edge_id != NO_EDGE;
+            edge_id = backward_side_.edges[graph_.GetEdge(edge_id).to]) {
+            edges.push_back(edge_id);
+        }
+
+        // The backward half is summed from the target, the exact weight is summed along the path
+        Weight weight = ZERO_WEIGHT;
+        for (const EdgeId edge_id : edges) {
+            weight += graph_.GetEdge(edge_id).weight;
+        }
+        return RouteInfo{ weight, std::move(edges) };
+    }
+
+    template <typename Weight>
+    typename BidirectionalRouter<Weight>::WeightMatrix BidirectionalRouter<Weight>::BuildWeightMatrix(
+        const std::vector<VertexId>& sources, const std::vector<VertexId>& targets) const {
+        const size_t vertex_count = graph_.GetVertexCount();
+        std::vector<bool> is_target(vertex_count, false);
+        size_t target_count = 0;
+        for (const VertexId to : targets) {
+            if (to >= vertex_count) {
+                throw std::out_of_range("Vertex id is out of range");
+            }
+            if (!is_target[to]) {
+                is_target[to] = true;
+                ++target_count;
+            }
+        }
+
+        WeightMatrix matrix;
+        matrix.reserve(sources.size() * targets.size());
+        SearchSide& side = forward_side_;
+        for (const VertexId from : sources) {
+            if (from >= vertex_count) {
+                throw std::out_of_range("Vertex id is out of range");
+            }
+            ResetSide(side);
+            Queue queue;
+            side.weights[from] = ZERO_WEIGHT;
+            side.touched.push_back(from);
+            queue.push({ ZERO_WEIGHT, from });
+            size_t remaining_count = target_count;
+            while (!queue.empty() && remaining_count > 0) {
+                const auto [weight, vertex] = queue.top();
+                queue.pop();
+                if (weight > side.weights[vertex]) continue;
+                if (is_target[vertex]) {
+                    --remaining_count;
+                }
+                const auto [arcs_begin, arcs_end] = forward_graph_.GetArcs(vertex);
+                for (ArcId arc = arcs_begin; arc < arcs_end; ++arc) {
+                    const VertexId vertex_to = forward_graph_.GetArcTarget(arc);
+                    const Weight candidate_weight = weight + forward_graph_.GetArcWeight(arc);
+                    if (candidate_weight >= side.weights[vertex_to]) continue;
+                    if (side.weights[vertex_to] == UNREACHABLE) {
+                        side.touched.push_back(vertex_to);
+                    }
+                    side.weights[vertex_to] = candidate_weight;
+                    side.edges[vertex_to] = forward_graph_.GetArcEdgeId(arc);
+                    queue.push({ candidate_weight, vertex_to });
+                }
+            }
+            for (const VertexId to : targets) {
+                matrix.push_back(side.weights[to] == UNREACHABLE ? std::nullopt
+                    : std::optional<Weight>(side.weights[to]));
+            }
+        }
+        return matrix;
+    }
+
+    template <typename Weight>
+    void BidirectionalRouter<Weight>::ResetSide(SearchSide& side) {
+        for (const VertexId vertex : side.touched) {
+            side.weights[vertex] = UNREACHABLE;
+            side.edges[vertex] = NO_EDGE;
+        }
+        side.touched.clear();
+    }
+
+}  // namespace graph
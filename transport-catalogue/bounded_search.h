@@ -0,0 +1,63 @@
+#pragma once
+
+#include "graph.h"
+
+#include <functional>
+#include <queue>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+    template <typename Weight>
+    struct ReachedVertex {
+        VertexId vertex;
+        Weight weight;
+    };
+
+    // Dijkstra from one vertex that never goes past max_weight. Weights are kept in a hash map
+    // instead of a per-vertex array, so the work is linear in the reached part of the graph.
+    // Returns the vertices with weight <= max_weight in the order of non-decreasing weight.
+    template <typename Weight>
+    std::vector<ReachedVertex<Weight>> FindVerticesWithin(const DirectedWeightedGraph<Weight>& graph,
+        VertexId from, Weight max_weight) {
+        if (from >= graph.GetVertexCount()) {
+            throw std::out_of_range("Vertex id is out of range");
+        }
+        std::vector<ReachedVertex<Weight>> reached;
+        if (max_weight < Weight{}) {
+            return reached;
+        }
+
+        using QueueItem = std::pair<Weight, VertexId>;
+        std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<QueueItem>> queue;
+        std::unordered_map<VertexId, Weight> weights;
+        weights.emplace(from, Weight{});
+        queue.push({ Weight{}, from });
+        while (!queue.empty()) {
+            const auto [weight, vertex] = queue.top();
+            queue.pop();
+            // Pushes happen on strict improvements only, so the current weight is popped once
+            if (weight > weights.at(vertex)) continue;
+            reached.push_back({ vertex, weight });
+            for (const EdgeId edge_id : graph.GetIncidentEdges(vertex)) {
+                const Edge<Weight>& edge = graph.GetEdge(edge_id);
+                if (edge.weight < Weight{}) {
+                    throw std::domain_error("Edges' weights should be non-negative");
+                }
+                const Weight candidate_weight = weight + edge.weight;
+                if (candidate_weight > max_weight) continue;
+                const auto [it, inserted] = weights.emplace(edge.to, candidate_weight);
+                if (!inserted) {
+                    if (candidate_weight >= it->second) continue;
+                    it->second = candidate_weight;
+                }
+                queue.push({ candidate_weight, edge.to });
+            }
+        }
+        return reached;
+    }
+
+}  // namespace graph
@@ -0,0 +1,579 @@
+#pragma once
+
+#include "graph.h"
+#include "router.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <optional>
+#include <queue>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+    // Answers routes with a contraction hierarchy: vertices are contracted one by one in rank order,
+    // shortcuts keep the distances between the remaining ones. A query runs Dijkstra upwards in rank
+    // from both ends and unpacks the shortcuts of the meeting path back into edges of the graph.
+    // Not thread-safe: BuildRoute reuses search buffers.
+    template <typename Weight>
+    class ContractionRouter final : public RouterEngine<Weight> {
+    private:
+        using Graph = DirectedWeightedGraph<Weight>;
+
+    public:
+        using typename RouterEngine<Weight>::RouteInfo;
+        using typename RouterEngine<Weight>::WeightMatrix;
+
+        // Arcs of the hierarchy are the edges of the graph followed by the shortcuts:
+        // arc id edge_count + i is the shortcut i. A shortcut is the path of its two halves,
+        // each of them an edge or an earlier shortcut.
+        using ArcId = uint32_t;
+
+        struct Shortcut {
+            ArcId first;
+            ArcId second;
+        };
+
+        struct HierarchyData {
+            std::vector<uint32_t> ranks;
+            std::vector<Shortcut> shortcuts;
+        };
+
+        explicit ContractionRouter(const Graph& graph);
+        ContractionRouter(const Graph& graph, HierarchyData hierarchy_data);
+
+        std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const override;
+
+        // Bucket-based many-to-many: the upward search of every target leaves its weight in buckets
+        // at the vertices it settles, the upward search of every source scans the buckets it meets
+        WeightMatrix BuildWeightMatrix(const std::vector<VertexId>& sources,
+            const std::vector<VertexId>& targets) const override;
+
+        const HierarchyData& GetHierarchyData() const;
+
+    private:
+        static constexpr Weight ZERO_WEIGHT{};
+        static constexpr Weight UNREACHABLE = std::numeric_limits<Weight>::max();
+        static constexpr ArcId NO_ARC = std::numeric_limits<ArcId>::max();
+        // A witness search gives up after this many vertices and keeps the shortcut,
+        // which only costs query time. Priorities are estimated with a shorter search.
+        static constexpr size_t WITNESS_SETTLED_LIMIT = 500;
+        static constexpr size_t PRIORITY_SETTLED_LIMIT = 30;
+
+        struct Link {
+            VertexId vertex;
+            Weight weight;
+            ArcId arc;
+        };
+
+        // Arcs leading upwards in rank, grouped by the lower end
+        struct SearchGraph {
+            std::vector<uint32_t> offsets;
+            std::vector<Link> links;
+        };
+
+        using QueueItem = std::pair<Weight, VertexId>;
+        using Queue = std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<QueueItem>>;
+
+        struct SearchSide {
+            std::vector<Weight> weights;
+            std::vector<ArcId> prev_arcs;
+            std::vector<VertexId> touched;
+        };
+
+        // The graph being contracted: links of not yet contracted vertices, the lightest one per pair
+        struct ContractionGraph {
+            std::vector<std::vector<Link>> out_links;
+            std::vector<std::vector<Link>> in_links;
+            std::vector<bool> contracted;
+            std::vector<Weight> witness_weights;
+            std::vector<VertexId> witness_touched;
+            std::vector<bool> witness_targets;
+        };
+
+        void InitializeArcs();
+        void Contract();
+        ContractionGraph MakeContractionGraph() const;
+        static std::vector<std::pair<Link, Link>> FindShortcuts(ContractionGraph& contraction_graph, VertexId vertex,
+            size_t settled_limit);
+        static void RunWitnessSearch(ContractionGraph& contraction_graph, VertexId from, VertexId skipped,
+            Weight max_weight, size_t target_count, size_t settled_limit);
+        static void SetLink(std::vector<Link>& links, Link link);
+        static void EraseLinks(std::vector<Link>& links, VertexId vertex);
+
+        void BuildSearchGraphs();
+        static void RelaxUpwards(const SearchGraph& search_graph, SearchSide& side, VertexId vertex, Weight weight,
+            Queue& queue);
+        static void SearchUpwards(const SearchGraph& search_graph, SearchSide& side, VertexId from,
+            std::vector<std::pair<VertexId, Weight>>& settled);
+        void UnpackArc(ArcId arc, std::vector<EdgeId>& edges) const;
+
+        const Graph& graph_;
+        HierarchyData hierarchy_data_;
+        std::vector<VertexId> arc_from_;
+        std::vector<VertexId> arc_to_;
+        std::vector<Weight> arc_weights_;
+        SearchGraph forward_graph_;
+        SearchGraph backward_graph_;
+        mutable SearchSide forward_side_;
+        mutable SearchSide backward_side_;
+    };
+
+    template <typename Weight>
+    ContractionRouter<Weight>::ContractionRouter(const Graph& graph)
+        : graph_(graph) {
+        InitializeArcs();
+        Contract();
+        BuildSearchGraphs();
+    }
+
+    template <typename Weight>
+    ContractionRouter<Weight>::ContractionRouter(const Graph& graph, HierarchyData hierarchy_data)
+        : graph_(graph)
+        , hierarchy_data_(std::move(hierarchy_data)) {
+        InitializeArcs();
+        const size_t vertex_count = graph.GetVertexCount();
+        const auto& ranks = hierarchy_data_.ranks;
+        std::vector<bool> rank_used(vertex_count, false);
+        if (ranks.size() != vertex_count) {
+            throw std::invalid_argument("Hierarchy doesn't match the graph");
+        }
+        for (const uint32_t rank : ranks) {
+            if (rank >= vertex_count || rank_used[rank]) {
+                throw std::invalid_argument("Hierarchy ranks are not a permutation");
+            }
+            rank_used[rank] = true;
+        }
+        for (const Shortcut& shortcut : hierarchy_data_.shortcuts) {
+            const size_t arc_count = arc_from_.size();
+            if (shortcut.first >= arc_count || shortcut.second >= arc_count
+                || arc_to_[shortcut.first] != arc_from_[shortcut.second]) {
+                throw std::invalid_argument("Hierarchy shortcut doesn't join two arcs");
+            }
+            arc_from_.push_back(arc_from_[shortcut.first]);
+            arc_to_.push_back(arc_to_[shortcut.second]);
+            arc_weights_.push_back(arc_weights_[shortcut.first] + arc_weights_[shortcut.second]);
+        }
+        BuildSearchGraphs();
+    }
+
+    template <typename Weight>
+    std::optional<typename ContractionRouter<Weight>::RouteInfo> ContractionRouter<Weight>::BuildRoute(VertexId from,
+        VertexId to) const {
+        const size_t vertex_count = graph_.GetVertexCount();
+        if (from >= vertex_count || to >= vertex_count) {
+            throw std::out_of_range("Vertex id is out of range");
+        }
+        for (SearchSide* side : { &forward_side_, &backward_side_ }) {
+            for (const VertexId vertex : side->touched) {
+                side->weights[vertex] = UNREACHABLE;
+                side->prev_arcs[vertex] = NO_ARC;
+            }
+            side->touched.clear();
+        }
+
+        Queue forward_queue;
+        Queue backward_queue;
+        forward_side_.weights[from] = ZERO_WEIGHT;
+        forward_side_.touched.push_back(from);
+        forward_queue.push({ ZERO_WEIGHT, from });
+        backward_side_.weights[to] = ZERO_WEIGHT;
+        backward_side_.touched.push_back(to);
+        backward_queue.push({ ZERO_WEIGHT, to });
+
+        // Each side stops once it can't improve the best meeting found so far
+        Weight best_weight = UNREACHABLE;
+        VertexId meeting_vertex = from;
+        while (true) {
+            const bool forward_done = forward_queue.empty() || forward_queue.top().first >= best_weight;
+            const bool backward_done = backward_queue.empty() || backward_queue.top().first >= best_weight;
+            if (forward_done && backward_done) break;
+            const bool forward_turn = backward_done
+                || (!forward_done && forward_queue.top().first <= backward_queue.top().first);
+            Queue& queue = forward_turn ? forward_queue : backward_queue;
+            SearchSide& side = forward_turn ? forward_side_ : backward_side_;
+            const SearchSide& other_side = forward_turn ? backward_side_ : forward_side_;
+            const auto [weight, vertex] = queue.top();
+            queue.pop();
+            if (weight > side.weights[vertex]) continue;
+            if (other_side.weights[vertex] != UNREACHABLE && weight + other_side.weights[vertex] < best_weight) {
+                best_weight = weight + other_side.weights[vertex];
+                meeting_vertex = vertex;
+            }
+            RelaxUpwards(forward_turn ? forward_graph_ : backward_graph_, side, vertex, weight, queue);
+        }
+        if (best_weight == UNREACHABLE) {
+            return std::nullopt;
+        }
+
+        std::vector<ArcId> arcs;
+        for (VertexId vertex = meeting_vertex; forward_side_.prev_arcs[vertex] != NO_ARC;
+            vertex = arc_from_[forward_side_.prev_arcs[vertex]]) {
+            arcs.push_back(forward_side_.prev_arcs[vertex]);
+        }
+        std::reverse(arcs.begin(), arcs.end());
+        for (VertexId vertex = meeting_vertex; backward_side_.prev_arcs[vertex] != NO_ARC;
+            vertex = arc_to_[backward_side_.prev_arcs[vertex]]) {
+            arcs.push_back(backward_side_.prev_arcs[vertex]);
+        }
+        std::vector<EdgeId> edges;
+        for (const ArcId arc : arcs) {
+            UnpackArc(arc, edges);
+        }
+
+        // Shortcut weights are sums in another order, the exact one is summed along the path
+        Weight weight = ZERO_WEIGHT;
+        for (const EdgeId edge_id : edges) {
+            weight += graph_.GetEdge(edge_id).weight;
+        }
+        return RouteInfo{ weight, std::move(edges) };
+    }
+
+    template <typename Weight>
+    typename ContractionRouter<Weight>::WeightMatrix ContractionRouter<Weight>::BuildWeightMatrix(
+        const std::vector<VertexId>& sources, const std::vector<VertexId>& targets) const {
+        const size_t vertex_count = graph_.GetVertexCount();
+        for (const std::vector<VertexId>* vertices : { &sources, &targets }) {
+            for (const VertexId vertex : *vertices) {
+                if (vertex >= vertex_count) {
+                    throw std::out_of_range("Vertex id is out of range");
+                }
+            }
+        }
+
+        std::vector<std::vector<std::pair<size_t, Weight>>> buckets(vertex_count);
+        std::vector<std::pair<VertexId, Weight>> settled;
+        for (size_t column = 0; column < targets.size(); ++column) {
+            SearchUpwards(backward_graph_, backward_side_, targets[column], settled);
+            for (const auto& [vertex, weight] : settled) {
+                buckets[vertex].push_back({ column, weight });
+            }
+        }
+
+        WeightMatrix matrix(sources.size() * targets.size());
+        for (size_t row = 0; row < sources.size(); ++row) {
+            SearchUpwards(forward_graph_, forward_side_, sources[row], settled);
+            for (const auto& [vertex, weight] : settled) {
+                for (const auto& [column, bucket_weight] : buckets[vertex]) {
+                    std::optional<Weight>& cell = matrix[row * targets.size() + column];
+                    if (!cell || weight + bucket_weight < *cell) {
+                        cell = weight + bucket_weight;
+                    }
+                }
+            }
+        }
+        return matrix;
+    }
+
+    template <typename Weight>
+    const typename ContractionRouter<Weight>::HierarchyData& ContractionRouter<Weight>::GetHierarchyData() const {
+        return hierarchy_data_;
+    }
+
+    template <typename Weight>
+    void ContractionRouter<Weight>::InitializeArcs() {
+        const size_t edge_count = graph_.GetEdgeCount();
+        if (edge_count >= NO_ARC || graph_.GetVertexCount() > std::numeric_limits<uint32_t>::max()) {
+            throw std::length_error("Graph is too large for the contraction hierarchy");
+        }
+        arc_from_.reserve(edge_count);
+        arc_to_.reserve(edge_count);
+        arc_weights_.reserve(edge_count);
+        for (EdgeId edge_id = 0; edge_id < edge_count; ++edge_id) {
+            const Edge<Weight>& edge = graph_.GetEdge(edge_id);
+            if (edge.weight < ZERO_WEIGHT) {
+                throw std::domain_error("Edges' weights should be non-negative");
+            }
+            arc_from_.push_back(edge.from);
+            arc_to_.push_back(edge.to);
+            arc_weights_.push_back(edge.weight);
+        }
+    }
+
+    template <typename Weight>
+    void ContractionRouter<Weight>::Contract() {
+        const size_t vertex_count = graph_.GetVertexCount();
+        ContractionGraph contraction_graph = MakeContractionGraph();
+        std::vector<int64_t> priorities(vertex_count);
+        std::vector<int64_t> contracted_neighbors(vertex_count, 0);
+
+        // Edge difference plus contracted neighbors: cheap vertices go first, spread over the graph
+        auto get_priority = [&](VertexId vertex) {
+            const int64_t shortcut_count = static_cast<int64_t>(
+                FindShortcuts(contraction_graph, vertex, PRIORITY_SETTLED_LIMIT).size());
+            const int64_t removed_count = static_cast<int64_t>(contraction_graph.in_links[vertex].size()
+                + contraction_graph.out_links[vertex].size());
+            return shortcut_count - removed_count + contracted_neighbors[vertex];
+        };
+
+        using PriorityItem = std::pair<int64_t, VertexId>;
+        std::priority_queue<PriorityItem, std::vector<PriorityItem>, std::greater<PriorityItem>> queue;
+        for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+            priorities[vertex] = get_priority(vertex);
+            queue.push({ priorities[vertex], vertex });
+        }
+
+        hierarchy_data_.ranks.assign(vertex_count, 0);
+        uint32_t next_rank = 0;
+        while (!queue.empty()) {
+            const auto [priority, vertex] = queue.top();
+            queue.pop();
+            if (contraction_graph.contracted[vertex] || priority != priorities[vertex]) continue;
+            // Contracting a vertex only bumps the priorities of its neighbors, the edge difference
+            // is brought up to date when a vertex comes out of the queue
+            priorities[vertex] = get_priority(vertex);
+            if (!queue.empty() && priorities[vertex] > queue.top().first) {
+                queue.push({ priorities[vertex], vertex });
+                continue;
+            }
+
+            for (const auto& [in_link, out_link] : FindShortcuts(contraction_graph, vertex, WITNESS_SETTLED_LIMIT)) {
+                const ArcId arc = static_cast<ArcId>(arc_from_.size());
+                if (arc == NO_ARC) {
+                    throw std::length_error("Too many shortcuts in the contraction hierarchy");
+                }
+                const Weight weight = in_link.weight + out_link.weight;
+                hierarchy_data_.shortcuts.push_back({ in_link.arc, out_link.arc });
+                arc_from_.push_back(in_link.vertex);
+                arc_to_.push_back(out_link.vertex);
+                arc_weights_.push_back(weight);
+                SetLink(contraction_graph.out_links[in_link.vertex], { out_link.vertex, weight, arc });
+                SetLink(contraction_graph.in_links[out_link.vertex], { in_link.vertex, weight, arc });
+            }
+
+            contraction_graph.contracted[vertex] = true;
+            hierarchy_data_.ranks[vertex] = next_rank++;
+            std::vector<VertexId> neighbors;
+            for (const Link& link : contraction_graph.in_links[vertex]) {
+                EraseLinks(contraction_graph.out_links[link.vertex], vertex);
+                neighbors.push_back(link.vertex);
+            }
+            for (const Link& link : contraction_graph.out_links[vertex]) {
+                EraseLinks(contraction_graph.in_links[link.vertex], vertex);
+                neighbors.push_back(link.vertex);
+            }
+            std::vector<Link>().swap(contraction_graph.in_links[vertex]);
+            std::vector<Link>().swap(contraction_graph.out_links[vertex]);
+            std::sort(neighbors.begin(), neighbors.end());
+            neighbors.erase(std::unique(neighbors.begin(), neighbors.end()), neighbors.end());
+            for (const VertexId neighbor : neighbors) {
+                ++contracted_neighbors[neighbor];
+                ++priorities[neighbor];
+                queue.push({ priorities[neighbor], neighbor });
+            }
+        }
+    }
+
+    template <typename Weight>
+    typename ContractionRouter<Weight>::ContractionGraph ContractionRouter<Weight>::MakeContractionGraph() const {
+        const size_t vertex_count = graph_.GetVertexCount();
+        ContractionGraph contraction_graph;
+        contraction_graph.out_links.resize(vertex_count);
+        contraction_graph.in_links.resize(vertex_count);
+        contraction_graph.contracted.assign(vertex_count, false);
+        contraction_graph.witness_weights.assign(vertex_count, UNREACHABLE);
+        contraction_graph.witness_targets.assign(vertex_count, false);
+        for (ArcId arc = 0; arc < arc_from_.size(); ++arc) {
+            const VertexId from = arc_from_[arc];
+            const VertexId to = arc_to_[arc];
+            if (from == to) continue;
+            SetLink(contraction_graph.out_links[from], { to, arc_weights_[arc], arc });
+            SetLink(contraction_graph.in_links[to], { from, arc_weights_[arc], arc });
+        }
+        return contraction_graph;
+    }
+
+    // Pairs of links u -> vertex -> w that need a shortcut u -> w once the vertex is gone.
+    // Out links go to distinct vertices, so they are the targets of the witness search.
+    template <typename Weight>
+    std::vector<std::pair<typename ContractionRouter<Weight>::Link, typename ContractionRouter<Weight>::Link>>
+        ContractionRouter<Weight>::FindShortcuts(ContractionGraph& contraction_graph, VertexId vertex,
+            size_t settled_limit) {
+        std::vector<std::pair<Link, Link>> shortcuts;
+        const std::vector<Link>& out_links = contraction_graph.out_links[vertex];
+        for (const Link& in_link : contraction_graph.in_links[vertex]) {
+            Weight max_weight = ZERO_WEIGHT;
+            size_t target_count = 0;
+            for (const Link& out_link : out_links) {
+                if (out_link.vertex == in_link.vertex) continue;
+                max_weight = std::max(max_weight, in_link.weight + out_link.weight);
+                contraction_graph.witness_targets[out_link.vertex] = true;
+                ++target_count;
+            }
+            if (target_count == 0) continue;
+            RunWitnessSearch(contraction_graph, in_link.vertex, vertex, max_weight, target_count, settled_limit);
+            for (const Link& out_link : out_links) {
+                contraction_graph.witness_targets[out_link.vertex] = false;
+                if (out_link.vertex == in_link.vertex) continue;
+                if (contraction_graph.witness_weights[out_link.vertex] > in_link.weight + out_link.weight) {
+                    shortcuts.push_back({ in_link, out_link });
+                }
+            }
+        }
+        return shortcuts;
+    }
+
+    template <typename Weight>
+    void ContractionRouter<Weight>::RunWitnessSearch(ContractionGraph& contraction_graph, VertexId from,
+        VertexId skipped, Weight max_weight, size_t target_count, size_t settled_limit) {
+        std::vector<Weight>& weights = contraction_graph.witness_weights;
+        for (const VertexId vertex : contraction_graph.witness_touched) {
+            weights[vertex] = UNREACHABLE;
+        }
+        contraction_graph.witness_touched.clear();
+
+        Queue queue;
+        weights[from] = ZERO_WEIGHT;
+        contraction_graph.witness_touched.push_back(from);
+        queue.push({ ZERO_WEIGHT, from });
+        size_t settled_count = 0;
+        while (!queue.empty() && settled_count < settled_limit) {
+            const auto [weight, vertex] = queue.top();
+            queue.pop();
+            if (weight > weights[vertex]) continue;
+            if (weight > max_weight) break;
+            ++settled_count;
+            if (contraction_graph.witness_targets[vertex] && --target_count == 0) break;
+            for (const Link& link : contraction_graph.out_links[vertex]) {
+                if (link.vertex == skipped) continue;
+                const Weight candidate_weight = weight + link.weight;
+                if (candidate_weight < weights[link.vertex]) {
+                    if (weights[link.vertex] == UNREACHABLE) {
+                        contraction_graph.witness_touched.push_back(link.vertex);
+                    }
+                    weights[link.vertex] = candidate_weight;
+                    queue.push({ candidate_weight, link.vertex });
+                }
+            }
+        }
+    }
+
+    // Keeps the lighter of the parallel links, the earlier one on ties
+    template <typename Weight>
+    void ContractionRouter<Weight>::SetLink(std::vector<Link>& links, Link link) {
+        for (Link& existing_link : links) {
+            if (existing_link.vertex == link.vertex) {
+                if (link.weight < existing_link.weight) {
+                    existing_link = link;
+                }
+                return;
+            }
+        }
+        links.push_back(link);
+    }
+
+    template <typename Weight>
+    void ContractionRouter<Weight>::EraseLinks(std::vector<Link>& links, VertexId vertex) {
+        links.erase(std::remove_if(links.begin(), links.end(),
+            [vertex](const Link& link) { return link.vertex == vertex; }), links.end());
+    }
+
+    // The forward search follows arcs up from their tails, the backward one follows arcs
+    // up from their heads against the direction
+    template <typename Weight>
+    void ContractionRouter<Weight>::BuildSearchGraphs() {
+        const size_t vertex_count = graph_.GetVertexCount();
+        const auto& ranks = hierarchy_data_.ranks;
+        for (SearchGraph* search_graph : { &forward_graph_, &backward_graph_ }) {
+            search_graph->offsets.assign(vertex_count + 1, 0);
+            search_graph->links.clear();
+        }
+        for (ArcId arc = 0; arc < arc_from_.size(); ++arc) {
+            const VertexId from = arc_from_[arc];
+            const VertexId to = arc_to_[arc];
+            if (ranks[from] < ranks[to]) {
+                ++forward_graph_.offsets[from + 1];
+            }
+            else if (ranks[to] < ranks[from]) {
+                ++backward_graph_.offsets[to + 1];
+            }
+        }
+        for (SearchGraph* search_graph : { &forward_graph_, &backward_graph_ }) {
+            auto& offsets = search_graph->offsets;
+            for (size_t i = 1; i < offsets.size(); ++i) {
+                offsets[i] += offsets[i - 1];
+            }
+            search_graph->links.resize(offsets.back());
+        }
+        std::vector<uint32_t> forward_positions(forward_graph_.offsets.begin(), forward_graph_.offsets.end() - 1);
+        std::vector<uint32_t> backward_positions(backward_graph_.offsets.begin(), backward_graph_.offsets.end() - 1);
+        for (ArcId arc = 0; arc < arc_from_.size(); ++arc) {
+            const VertexId from = arc_from_[arc];
+            const VertexId to = arc_to_[arc];
+            if (ranks[from] < ranks[to]) {
+                forward_graph_.links[forward_positions[from]++] = { to, arc_weights_[arc], arc };
+            }
+            else if (ranks[to] < ranks[from]) {
+                backward_graph_.links[backward_positions[to]++] = { from, arc_weights_[arc], arc };
+            }
+        }
+        for (SearchSide* side : { &forward_side_, &backward_side_ }) {
+            side->weights.assign(vertex_count, UNREACHABLE);
+            side->prev_arcs.assign(vertex_count, NO_ARC);
+            side->touched.clear();
+        }
+    }
+
+    template <typename Weight>
+    void ContractionRouter<Weight>::RelaxUpwards(const SearchGraph& search_graph, SearchSide& side, VertexId vertex,
+        Weight weight, Queue& queue) {
+        for (uint32_t i = search_graph.offsets[vertex]; i < search_graph.offsets[vertex + 1]; ++i) {
+            const Link& link = search_graph.links[i];
+            const Weight candidate_weight = weight + link.weight;
+            if (candidate_weight < side.weights[link.vertex]) {
+                if (side.weights[link.vertex] == UNREACHABLE) {
+                    side.touched.push_back(link.vertex);
+                }
+                side.weights[link.vertex] = candidate_weight;
+                side.prev_arcs[link.vertex] = link.arc;
+                queue.push({ candidate_weight, link.vertex });
+            }
+        }
+    }
+
+    // Settles everything reachable upwards, the search space of a vertex is small
+    template <typename Weight>
+    void ContractionRouter<Weight>::SearchUpwards(const SearchGraph& search_graph, SearchSide& side, VertexId from,
+        std::vector<std::pair<VertexId, Weight>>& settled) {
+        for (const VertexId vertex : side.touched) {
+            side.weights[vertex] = UNREACHABLE;
+            side.prev_arcs[vertex] = NO_ARC;
+        }
+        side.touched.clear();
+        settled.clear();
+
+        Queue queue;
+        side.weights[from] = ZERO_WEIGHT;
+        side.touched.push_back(from);
+        queue.push({ ZERO_WEIGHT, from });
+        while (!queue.empty()) {
+            const auto [weight, vertex] = queue.top();
+            queue.pop();
+            if (weight > side.weights[vertex]) continue;
+            settled.push_back({ vertex, weight });
+            RelaxUpwards(search_graph, side, vertex, weight, queue);
+        }
+    }
+
+    template <typename Weight>
+    void ContractionRouter<Weight>::UnpackArc(ArcId arc, std::vector<EdgeId>& edges) const {
+        const size_t edge_count = graph_.GetEdgeCount();
+        std::vector<ArcId> stack{ arc };
+        while (!stack.empty()) {
+            const ArcId top = stack.back();
+            stack.pop_back();
+            if (top < edge_count) {
+                edges.push_back(top);
+                continue;
+            }
+            const Shortcut& shortcut = hierarchy_data_.shortcuts[top - edge_count];
+            stack.push_back(shortcut.second);
+            stack.push_back(shortcut.first);
+        }
+    }
+
+}  // namespace graph
@@ -2,44 +2,56 @@
 
 #include "geo.h"
 
+#include <cstdint>
+#include <limits>
 #include <string>
 #include <string_view>
 #include <vector>
-#include <unordered_map>
 
 namespace domain {
 
+// Dense ids in the order stops and buses are added to the catalogue.
+// Coordinates and routes are kept in the arrays of the catalogue by these ids.
+using StopId = uint32_t;
+using BusId = uint32_t;
+
+inline constexpr StopId NO_STOP = std::numeric_limits<StopId>::max();
+inline constexpr BusId NO_BUS = std::numeric_limits<BusId>::max();
+
 struct Stop {
-    Stop(const std::string& name, const geo::Coordinates& coordinates)
-        : name(name)
-        , coordinates(coordinates) {
-    }
-    
-    int GetDistance(Stop* to) {
-        if (stop_distances.count(to->name))
-            return stop_distances.at(to->name);
-        else if (to->stop_distances.count(this->name))
-            return to->stop_distances.at(this->name);
-        else
-            return 0;
+    Stop(StopId id, const std::string& name)
+        : id(id)
+        , name(name) {
     }
 
+
+    StopId id;
     std::string name;
-    geo::Coordinates coordinates;
-    std::unordered_map<std::string_view, int> stop_distances;
+};
+
+// Road distance as it was set for the direction from -> to
+struct RoadDistance {
+    StopId from;
+    StopId to;
+    int distance;
+};
+
+// Computed once per bus, the curvature is route_length / geo_length
+struct BusStats {
+    int route_length = 0;
+    double geo_length = 0.0;
+    int stop_count = 0;
+    int unique_stop_count = 0;
 };
 
 struct Bus {
-    Bus(const std::string& name, std::vector<Stop*> stops, bool is_circle)
-        : name(name)
-        , stops(stops)
-        , is_circle(is_circle) {
+    Bus(BusId id, const std::string& name)
+        : id(id)
+        , name(name) {
     }
 
+    BusId id;
     std::string name;
-    std::vector<Stop*> stops;
-    bool is_circle;
-    Stop* final_stop = nullptr;
 };  
 
 } //namespace domain
\ No newline at end of file
@@ -0,0 +1,133 @@
+#pragma once
+
+#include "graph.h"
+
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+namespace graph {
+
+    // FORWARD arcs follow the edges, BACKWARD arcs lead from the head of an edge to its tail
+    enum class ArcDirection {
+        FORWARD,
+        BACKWARD
+    };
+
+    // Read-only copy of a graph in compressed sparse row layout: the arcs leaving a vertex
+    // are [offsets[vertex], offsets[vertex + 1]) of the parallel arrays of targets, weights
+    // and edge ids. Arcs keep the order of the incidence lists. Names and spans of the edges
+    // stay in the source graph, an edge id points back to them.
+    template <typename Weight>
+    class FrozenGraph {
+    public:
+        using ArcId = uint32_t;
+
+        struct ArcRange {
+            ArcId begin;
+            ArcId end;
+        };
+
+        FrozenGraph() = default;
+        explicit FrozenGraph(const DirectedWeightedGraph<Weight>& graph,
+            ArcDirection direction = ArcDirection::FORWARD);
+
+        size_t GetVertexCount() const;
+        size_t GetArcCount() const;
+
+        // Arc accessors are unchecked, ids are expected to come from GetArcs
+        ArcRange GetArcs(VertexId vertex) const;
+        VertexId GetArcTarget(ArcId arc) const;
+        Weight GetArcWeight(ArcId arc) const;
+        EdgeId GetArcEdgeId(ArcId arc) const;
+
+    private:
+        std::vector<ArcId> offsets_;
+        std::vector<uint32_t> targets_;
+        std::vector<Weight> weights_;
+        std::vector<uint32_t> edge_ids_;
+    };
+
+    template <typename Weight>
+    FrozenGraph<Weight>::FrozenGraph(const DirectedWeightedGraph<Weight>& graph, ArcDirection direction) {
+        const size_t vertex_count = graph.GetVertexCount();
+        const size_t edge_count = graph.GetEdgeCount();
+        if (vertex_count > std::numeric_limits<uint32_t>::max()
+            || edge_count > std::numeric_limits<ArcId>::max()) {
+            throw std::length_error("Graph is too large for 32-bit ids");
+        }
+        if (direction == ArcDirection::FORWARD) {
+            offsets_.reserve(vertex_count + 1);
+            targets_.reserve(edge_count);
+            weights_.reserve(edge_count);
+            edge_ids_.reserve(edge_count);
+            offsets_.push_back(0);
+            for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+                for (const EdgeId edge_id : graph.GetIncidentEdges(vertex)) {
+                    const Edge<Weight>& edge = graph.GetEdge(edge_id);
+                    targets_.push_back(static_cast<uint32_t>(edge.to));
+                    weights_.push_back(edge.weight);
+                    edge_ids_.push_back(static_cast<uint32_t>(edge_id));
+                }
+                offsets_.push_back(static_cast<ArcId>(targets_.size()));
+            }
+            return;
+        }
+
+        // Counting sort by head, stable in the order of the incidence lists
+        offsets_.assign(vertex_count + 1, 0);
+        for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+            for (const EdgeId edge_id : graph.GetIncidentEdges(vertex)) {
+                ++offsets_[graph.GetEdge(edge_id).to + 1];
+            }
+        }
+        for (size_t i = 1; i < offsets_.size(); ++i) {
+            offsets_[i] += offsets_[i - 1];
+        }
+        targets_.resize(offsets_.back());
+        weights_.resize(offsets_.back());
+        edge_ids_.resize(offsets_.back());
+        std::vector<ArcId> positions(offsets_.begin(), offsets_.end() - 1);
+        for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+            for (const EdgeId edge_id : graph.GetIncidentEdges(vertex)) {
+                const Edge<Weight>& edge = graph.GetEdge(edge_id);
+                const ArcId arc = positions[edge.to]++;
+                targets_[arc] = static_cast<uint32_t>(edge.from);
+                weights_[arc] = edge.weight;
+                edge_ids_[arc] = static_cast<uint32_t>(edge_id);
+            }
+        }
+    }
+
+    template <typename Weight>
+    size_t FrozenGraph<Weight>::GetVertexCount() const {
+        return offsets_.empty() ? 0 : offsets_.size() - 1;
+    }
+
+    template <typename Weight>
+    size_t FrozenGraph<Weight>::GetArcCount() const {
+        return targets_.size();
+    }
+
+    template <typename Weight>
+    typename FrozenGraph<Weight>::ArcRange FrozenGraph<Weight>::GetArcs(VertexId vertex) const {
+        return { offsets_.at(vertex), offsets_.at(vertex + 1) };
+    }
+
+    template <typename Weight>
+    VertexId FrozenGraph<Weight>::GetArcTarget(ArcId arc) const {
+        return targets_[arc];
+    }
+
+    template <typename Weight>
+    Weight FrozenGraph<Weight>::GetArcWeight(ArcId arc) const {
+        return weights_[arc];
+    }
+
+    template <typename Weight>
+    EdgeId FrozenGraph<Weight>::GetArcEdgeId(ArcId arc) const {
+        return edge_ids_[arc];
+    }
+
+}  // namespace graph
@@ -3,6 +3,7 @@
 #include "ranges.h"
 
 #include <utility>
+#include <cstdint>
 #include <cstdlib>
 #include <vector>
 #include <string>
@@ -12,10 +13,12 @@ namespace graph {
 
     using VertexId = size_t;
     using EdgeId = size_t;
+    // Edges refer to their names by id in the name table of the graph
+    using NameId = uint32_t;
 
     template <typename Weight>
     struct Edge {
-        std::string name;
+        NameId name_id;
         size_t quality;
         VertexId from;
         VertexId to;
@@ -32,30 +35,35 @@ namespace graph {
         DirectedWeightedGraph() = default;
         explicit DirectedWeightedGraph(size_t vertex_count);
         explicit DirectedWeightedGraph(std::vector<Edge<Weight>> edges,
-            std::vector<std::vector<EdgeId>> incidence_lists);
+            std::vector<std::vector<EdgeId>> incidence_lists, std::vector<std::string> names);
         EdgeId AddEdge(Edge<Weight>&& edge);
+        NameId AddName(std::string name);
+        void SetEdgeWeight(EdgeId edge_id, Weight weight);
 
         size_t GetVertexCount() const;
         size_t GetEdgeCount() const;
         const Edge<Weight>& GetEdge(EdgeId edge_id) const;
         IncidentEdgesRange GetIncidentEdges(VertexId vertex) const;
+        size_t GetNameCount() const;
+        const std::string& GetName(NameId name_id) const;
 
     private:
         std::vector<Edge<Weight>> edges_;
         std::vector<IncidenceList> incidence_lists_;
+        std::vector<std::string> names_;
     };
 
     template <typename Weight>
     DirectedWeightedGraph<Weight>::DirectedWeightedGraph(size_t vertex_count)
         : incidence_lists_(vertex_count) {
-        edges_.reserve(vertex_count * vertex_count);
     }
 
     template <typename Weight>
     DirectedWeightedGraph<Weight>::DirectedWeightedGraph(std::vector<Edge<Weight>> edges,
-        std::vector<std::vector<EdgeId>> incidence_lists)
-        : edges_(edges)
-        , incidence_lists_(incidence_lists) {}
+        std::vector<std::vector<EdgeId>> incidence_lists, std::vector<std::string> names)
+        : edges_(std::move(edges))
+        , incidence_lists_(std::move(incidence_lists))
+        , names_(std::move(names)) {}
 
     template <typename Weight>
     EdgeId DirectedWeightedGraph<Weight>::AddEdge(Edge<Weight>&& edge) {
@@ -65,6 +73,17 @@ namespace graph {
         return id;
     }
 
+    template <typename Weight>
+    void DirectedWeightedGraph<Weight>::SetEdgeWeight(EdgeId edge_id, Weight weight) {
+        edges_.at(edge_id).weight = weight;
+    }
+
+    template <typename Weight>
+    NameId DirectedWeightedGraph<Weight>::AddName(std::string name) {
+        names_.push_back(std::move(name));
+        return static_cast<NameId>(names_.size() - 1);
+    }
+
     template <typename Weight>
     size_t DirectedWeightedGraph<Weight>::GetVertexCount() const {
         return incidence_lists_.size();
@@ -85,5 +104,15 @@ namespace graph {
         DirectedWeightedGraph<Weight>::GetIncidentEdges(VertexId vertex) const {
         return ranges::AsRange(incidence_lists_.at(vertex));
     }
+
+    template <typename Weight>
+    size_t DirectedWeightedGraph<Weight>::GetNameCount() const {
+        return names_.size();
+    }
+
+    template <typename Weight>
+    const std::string& DirectedWeightedGraph<Weight>::GetName(NameId name_id) const {
+        return names_.at(name_id);
+    }
     
 }  // namespace graph
\ No newline at end of file
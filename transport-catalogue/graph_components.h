@@ -0,0 +1,58 @@
+#pragma once
+
+#include "graph.h"
+
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+
+namespace graph {
+
+    using ComponentId = uint32_t;
+
+    // Weakly connected components: no edge joins two of them, so no route leads from one to another.
+    // Returns the component of every vertex, components are numbered in the order of their smallest vertices.
+    template <typename Weight>
+    std::vector<ComponentId> FindComponents(const DirectedWeightedGraph<Weight>& graph) {
+        const size_t vertex_count = graph.GetVertexCount();
+        if (vertex_count > std::numeric_limits<ComponentId>::max()) {
+            throw std::length_error("Graph is too large for 32-bit component ids");
+        }
+        std::vector<VertexId> parents(vertex_count);
+        std::iota(parents.begin(), parents.end(), VertexId{ 0 });
+        auto find_root = [&parents](VertexId vertex) {
+            while (parents[vertex] != vertex) {
+                parents[vertex] = parents[parents[vertex]];
+                vertex = parents[vertex];
+            }
+            return vertex;
+        };
+        for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id) {
+            const Edge<Weight>& edge = graph.GetEdge(edge_id);
+            const VertexId from_root = find_root(edge.from);
+            const VertexId to_root = find_root(edge.to);
+            // The smaller root wins, so every root is the smallest vertex of its component
+            if (from_root < to_root) {
+                parents[to_root] = from_root;
+            }
+            else {
+                parents[from_root] = to_root;
+            }
+        }
+
+        constexpr ComponentId NO_COMPONENT = std::numeric_limits<ComponentId>::max();
+        std::vector<ComponentId> components(vertex_count, NO_COMPONENT);
+        ComponentId component_count = 0;
+        for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+            const VertexId root = find_root(vertex);
+            if (components[root] == NO_COMPONENT) {
+                components[root] = component_count++;
+            }
+            components[vertex] = components[root];
+        }
+        return components;
+    }
+
+}  // namespace graph
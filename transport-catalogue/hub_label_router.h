@@ -0,0 +1,424 @@
+#pragma once
+
+#include "contraction_router.h"
+#include "frozen_graph.h"
+#include "graph.h"
+#include "router.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <optional>
+#include <queue>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+    // Order in which the vertices become hubs. SAMPLED_PATHS ranks vertices by the shortest paths
+    // through them in a few full Dijkstra trees and is cheap on any graph. CONTRACTION takes the
+    // reversed order of a contraction hierarchy, which gives much smaller labels on sparse graphs
+    // but contracts dense ones for too long.
+    enum class HubOrder {
+        SAMPLED_PATHS,
+        CONTRACTION
+    };
+
+    // Answers routes with a 2-hop cover: every vertex keeps the weights to and from a few hubs,
+    // any shortest path passes through a hub common to the out label of its start and the in label
+    // of its end. The route weight is a merge of two label arrays sorted by hub, the path is
+    // unpacked from the edges each label entry keeps along the shortest path tree of its hub.
+    // Labels are built by pruned Dijkstra searches from the hubs in the order of importance.
+    template <typename Weight>
+    class HubLabelRouter final : public RouterEngine<Weight> {
+    private:
+        using Graph = DirectedWeightedGraph<Weight>;
+
+    public:
+        using typename RouterEngine<Weight>::RouteInfo;
+        using typename RouterEngine<Weight>::WeightMatrix;
+
+        static constexpr uint32_t NO_EDGE = std::numeric_limits<uint32_t>::max();
+
+        // Hubs are numbered in the order of importance. The edge is the first edge of the path
+        // to the hub in an out label and the last edge of the path from the hub in an in label,
+        // NO_EDGE in the entry of the hub itself.
+        struct LabelEntry {
+            uint32_t hub;
+            uint32_t edge;
+            Weight weight;
+        };
+
+        // Label of the vertex v is [offsets[v], offsets[v + 1]) of the entries, sorted by hub
+        struct Labels {
+            std::vector<uint32_t> offsets;
+            std::vector<LabelEntry> entries;
+        };
+
+        struct LabelData {
+            Labels out_labels;
+            Labels in_labels;
+        };
+
+        explicit HubLabelRouter(const Graph& graph, HubOrder hub_order = HubOrder::SAMPLED_PATHS);
+        HubLabelRouter(const Graph& graph, LabelData label_data);
+
+        std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const override;
+
+        // A label merge per cell, no path is unpacked
+        WeightMatrix BuildWeightMatrix(const std::vector<VertexId>& sources,
+            const std::vector<VertexId>& targets) const override;
+
+        const LabelData& GetLabelData() const;
+
+    private:
+        static constexpr Weight ZERO_WEIGHT{};
+        static constexpr Weight UNREACHABLE = std::numeric_limits<Weight>::max();
+        // Shortest path trees sampled to order the hubs
+        static constexpr size_t ORDER_SAMPLE_COUNT = 32;
+
+        using QueueItem = std::pair<Weight, VertexId>;
+        using Queue = std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<QueueItem>>;
+
+        std::pair<Weight, uint32_t> MergeLabels(VertexId from, VertexId to) const;
+        void BuildLabels(HubOrder hub_order);
+        std::vector<VertexId> GetSampledPathOrder(const FrozenGraph<Weight>& forward_graph) const;
+        std::vector<VertexId> GetContractionOrder() const;
+        static void RunPrunedSearch(const FrozenGraph<Weight>& frozen_graph, VertexId hub_vertex, uint32_t hub,
+            const std::vector<LabelEntry>& hub_label, std::vector<std::vector<LabelEntry>>& labels,
+            std::vector<Weight>& hub_weights, std::vector<Weight>& weights, std::vector<uint32_t>& prev_edges);
+        static Labels FlattenLabels(std::vector<std::vector<LabelEntry>>& labels);
+        void CheckLabels(const Labels& labels) const;
+        const LabelEntry& FindEntry(const Labels& labels, VertexId vertex, uint32_t hub) const;
+
+        const Graph& graph_;
+        LabelData label_data_;
+    };
+
+    template <typename Weight>
+    HubLabelRouter<Weight>::HubLabelRouter(const Graph& graph, HubOrder hub_order)
+        : graph_(graph) {
+        BuildLabels(hub_order);
+    }
+
+    template <typename Weight>
+    HubLabelRouter<Weight>::HubLabelRouter(const Graph& graph, LabelData label_data)
+        : graph_(graph)
+        , label_data_(std::move(label_data)) {
+        CheckLabels(label_data_.out_labels);
+        CheckLabels(label_data_.in_labels);
+    }
+
+    template <typename Weight>
+    std::optional<typename HubLabelRouter<Weight>::RouteInfo> HubLabelRouter<Weight>::BuildRoute(VertexId from,
+        VertexId to) const {
+        const size_t vertex_count = graph_.GetVertexCount();
+        if (from >= vertex_count || to >= vertex_count) {
+            throw std::out_of_range("Vertex id is out of range");
+        }
+        if (from == to) {
+            return RouteInfo{ ZERO_WEIGHT, {} };
+        }
+        const uint32_t best_hub = MergeLabels(from, to).second;
+        if (best_hub == NO_EDGE) {
+            return std::nullopt;
+        }
+
+        const Labels& out_labels = label_data_.out_labels;
+        const Labels& in_labels = label_data_.in_labels;
+        std::vector<EdgeId> edges;
+        for (VertexId vertex = from;;) {
+            const uint32_t edge = FindEntry(out_labels, vertex, best_hub).edge;
+            if (edge == NO_EDGE) break;
+            edges.push_back(edge);
+            vertex = graph_.GetEdge(edge).to;
+        }
+        const size_t first_half_size = edges.size();
+        for (VertexId vertex = to;;) {
+            const uint32_t edge = FindEntry(in_labels, vertex, best_hub).edge;
+            if (edge == NO_EDGE) break;
+            edges.push_back(edge);
+            vertex = graph_.GetEdge(edge).from;
+        }
+        std::reverse(edges.begin() + first_half_size, edges.end());
+
+        // Label weights are summed from the hub outwards, the exact one is summed along the path
+        Weight weight = ZERO_WEIGHT;
+        for (const EdgeId edge_id : edges) {
+            weight += graph_.GetEdge(edge_id).weight;
+        }
+        return RouteInfo{ weight, std::move(edges) };
+    }
+
+    template <typename Weight>
+    typename HubLabelRouter<Weight>::WeightMatrix HubLabelRouter<Weight>::BuildWeightMatrix(
+        const std::vector<VertexId>& sources, const std::vector<VertexId>& targets) const {
+        const size_t vertex_count = graph_.GetVertexCount();
+        WeightMatrix matrix;
+        matrix.reserve(sources.size() * targets.size());
+        for (const VertexId from : sources) {
+            for (const VertexId to : targets) {
+                if (from >= vertex_count || to >= vertex_count) {
+                    throw std::out_of_range("Vertex id is out of range");
+                }
+                if (from == to) {
+                    matrix.push_back(ZERO_WEIGHT);
+                    continue;
+                }
+                const auto [weight, hub] = MergeLabels(from, to);
+                matrix.push_back(hub == NO_EDGE ? std::nullopt : std::optional<Weight>(weight));
+            }
+        }
+        return matrix;
+    }
+
+    template <typename Weight>
+    const typename HubLabelRouter<Weight>::LabelData& HubLabelRouter<Weight>::GetLabelData() const {
+        return label_data_;
+    }
+
+    // The lightest common hub of the out label of the source and the in label of the target,
+    // NO_EDGE without one
+    template <typename Weight>
+    std::pair<Weight, uint32_t> HubLabelRouter<Weight>::MergeLabels(VertexId from, VertexId to) const {
+        const Labels& out_labels = label_data_.out_labels;
+        const Labels& in_labels = label_data_.in_labels;
+        Weight best_weight = UNREACHABLE;
+        uint32_t best_hub = NO_EDGE;
+        uint32_t out_index = out_labels.offsets[from];
+        uint32_t in_index = in_labels.offsets[to];
+        const uint32_t out_end = out_labels.offsets[from + 1];
+        const uint32_t in_end = in_labels.offsets[to + 1];
+        while (out_index < out_end && in_index < in_end) {
+            const LabelEntry& out_entry = out_labels.entries[out_index];
+            const LabelEntry& in_entry = in_labels.entries[in_index];
+            if (out_entry.hub < in_entry.hub) {
+                ++out_index;
+            }
+            else if (in_entry.hub < out_entry.hub) {
+                ++in_index;
+            }
+            else {
+                if (out_entry.weight + in_entry.weight < best_weight) {
+                    best_weight = out_entry.weight + in_entry.weight;
+                    best_hub = out_entry.hub;
+                }
+                ++out_index;
+                ++in_index;
+            }
+        }
+        return { best_weight, best_hub };
+    }
+
+    template <typename Weight>
+    void HubLabelRouter<Weight>::BuildLabels(HubOrder hub_order) {
+        const size_t vertex_count = graph_.GetVertexCount();
+        if (graph_.GetEdgeCount() >= NO_EDGE) {
+            throw std::length_error("Graph is too large for hub labels");
+        }
+        for (EdgeId edge_id = 0; edge_id < graph_.GetEdgeCount(); ++edge_id) {
+            if (graph_.GetEdge(edge_id).weight < ZERO_WEIGHT) {
+                throw std::domain_error("Edges' weights should be non-negative");
+            }
+        }
+        const FrozenGraph<Weight> forward_graph(graph_);
+        const FrozenGraph<Weight> backward_graph(graph_, ArcDirection::BACKWARD);
+
+        std::vector<std::vector<LabelEntry>> out_labels(vertex_count);
+        std::vector<std::vector<LabelEntry>> in_labels(vertex_count);
+        std::vector<Weight> hub_weights(vertex_count, UNREACHABLE);
+        std::vector<Weight> weights(vertex_count, UNREACHABLE);
+        std::vector<uint32_t> prev_edges(vertex_count, NO_EDGE);
+        const std::vector<VertexId> hub_vertices = hub_order == HubOrder::CONTRACTION
+            ? GetContractionOrder() : GetSampledPathOrder(forward_graph);
+        for (uint32_t hub = 0; hub < vertex_count; ++hub) {
+            const VertexId hub_vertex = hub_vertices[hub];
+            // Paths from the hub go to in labels and are pruned by the out label of the hub, and back
+            RunPrunedSearch(forward_graph, hub_vertex, hub, out_labels[hub_vertex], in_labels,
+                hub_weights, weights, prev_edges);
+            RunPrunedSearch(backward_graph, hub_vertex, hub, in_labels[hub_vertex], out_labels,
+                hub_weights, weights, prev_edges);
+        }
+        label_data_.out_labels = FlattenLabels(out_labels);
+        label_data_.in_labels = FlattenLabels(in_labels);
+    }
+
+    // Vertices that many shortest paths pass through make the best hubs. The paths are
+    // sampled from full shortest path trees of evenly spread sources, a vertex scores
+    // the number of vertices below it in these trees.
+    template <typename Weight>
+    std::vector<VertexId> HubLabelRouter<Weight>::GetSampledPathOrder(const FrozenGraph<Weight>& forward_graph) const {
+        const size_t vertex_count = graph_.GetVertexCount();
+        std::vector<uint64_t> scores(vertex_count, 0);
+        std::vector<Weight> weights(vertex_count);
+        std::vector<uint32_t> parents(vertex_count);
+        std::vector<uint64_t> subtree_sizes(vertex_count);
+        std::vector<VertexId> settled;
+        const size_t sample_count = std::min(vertex_count, ORDER_SAMPLE_COUNT);
+        for (size_t sample = 0; sample < sample_count; ++sample) {
+            const VertexId source = static_cast<VertexId>(sample * vertex_count / sample_count);
+            std::fill(weights.begin(), weights.end(), UNREACHABLE);
+            settled.clear();
+            Queue queue;
+            weights[source] = ZERO_WEIGHT;
+            parents[source] = static_cast<uint32_t>(source);
+            queue.push({ ZERO_WEIGHT, source });
+            while (!queue.empty()) {
+                const auto [weight, vertex] = queue.top();
+                queue.pop();
+                if (weight > weights[vertex]) continue;
+                settled.push_back(vertex);
+                subtree_sizes[vertex] = 1;
+                const auto [arc_begin, arc_end] = forward_graph.GetArcs(vertex);
+                for (auto arc = arc_begin; arc < arc_end; ++arc) {
+                    const VertexId target = forward_graph.GetArcTarget(arc);
+                    const Weight candidate_weight = weight + forward_graph.GetArcWeight(arc);
+                    if (candidate_weight < weights[target]) {
+                        weights[target] = candidate_weight;
+                        parents[target] = static_cast<uint32_t>(vertex);
+                        queue.push({ candidate_weight, target });
+                    }
+                }
+            }
+            for (auto it = settled.rbegin(); it != settled.rend(); ++it) {
+                scores[*it] += subtree_sizes[*it];
+                if (*it != source) {
+                    subtree_sizes[parents[*it]] += subtree_sizes[*it];
+                }
+            }
+        }
+
+        std::vector<VertexId> hub_vertices(vertex_count);
+        for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+            hub_vertices[vertex] = vertex;
+        }
+        std::stable_sort(hub_vertices.begin(), hub_vertices.end(),
+            [&scores](VertexId lhs, VertexId rhs) { return scores[lhs] > scores[rhs]; });
+        return hub_vertices;
+    }
+
+    // The last contracted vertices carry the most shortcuts, they go first
+    template <typename Weight>
+    std::vector<VertexId> HubLabelRouter<Weight>::GetContractionOrder() const {
+        const std::vector<uint32_t> ranks = ContractionRouter<Weight>(graph_).GetHierarchyData().ranks;
+        std::vector<VertexId> hub_vertices(ranks.size());
+        for (VertexId vertex = 0; vertex < ranks.size(); ++vertex) {
+            hub_vertices[ranks.size() - 1 - ranks[vertex]] = vertex;
+        }
+        return hub_vertices;
+    }
+
+    // Dijkstra from the hub along the arcs of the frozen graph. A vertex already covered by
+    // the earlier hubs at no greater weight is neither labeled nor expanded, so the tree edges
+    // of every labeled vertex lead through labeled vertices back to the hub.
+    template <typename Weight>
+    void HubLabelRouter<Weight>::RunPrunedSearch(const FrozenGraph<Weight>& frozen_graph, VertexId hub_vertex,
+        uint32_t hub, const std::vector<LabelEntry>& hub_label, std::vector<std::vector<LabelEntry>>& labels,
+        std::vector<Weight>& hub_weights, std::vector<Weight>& weights, std::vector<uint32_t>& prev_edges) {
+        for (const LabelEntry& entry : hub_label) {
+            hub_weights[entry.hub] = entry.weight;
+        }
+
+        std::vector<VertexId> touched{ hub_vertex };
+        Queue queue;
+        weights[hub_vertex] = ZERO_WEIGHT;
+        queue.push({ ZERO_WEIGHT, hub_vertex });
+        while (!queue.empty()) {
+            const auto [weight, vertex] = queue.top();
+            queue.pop();
+            if (weight > weights[vertex]) continue;
+            std::vector<LabelEntry>& label = labels[vertex];
+            bool covered = false;
+            for (const LabelEntry& entry : label) {
+                if (hub_weights[entry.hub] != UNREACHABLE && hub_weights[entry.hub] + entry.weight <= weight) {
+                    covered = true;
+                    break;
+                }
+            }
+            if (covered) continue;
+            label.push_back({ hub, prev_edges[vertex], weight });
+
+            const auto [arc_begin, arc_end] = frozen_graph.GetArcs(vertex);
+            for (auto arc = arc_begin; arc < arc_end; ++arc) {
+                const VertexId target = frozen_graph.GetArcTarget(arc);
+                const Weight candidate_weight = weight + frozen_graph.GetArcWeight(arc);
+                if (candidate_weight < weights[target]) {
+                    if (weights[target] == UNREACHABLE) {
+                        touched.push_back(target);
+                    }
+                    weights[target] = candidate_weight;
+                    prev_edges[target] = static_cast<uint32_t>(frozen_graph.GetArcEdgeId(arc));
+                    queue.push({ candidate_weight, target });
+                }
+            }
+        }
+
+        for (const VertexId vertex : touched) {
+            weights[vertex] = UNREACHABLE;
+            prev_edges[vertex] = NO_EDGE;
+        }
+        for (const LabelEntry& entry : hub_label) {
+            hub_weights[entry.hub] = UNREACHABLE;
+        }
+    }
+
+    template <typename Weight>
+    typename HubLabelRouter<Weight>::Labels HubLabelRouter<Weight>::FlattenLabels(
+        std::vector<std::vector<LabelEntry>>& labels) {
+        Labels flat_labels;
+        size_t entry_count = 0;
+        for (const auto& label : labels) {
+            entry_count += label.size();
+        }
+        if (entry_count >= std::numeric_limits<uint32_t>::max()) {
+            throw std::length_error("Too many hub label entries");
+        }
+        flat_labels.offsets.reserve(labels.size() + 1);
+        flat_labels.entries.reserve(entry_count);
+        flat_labels.offsets.push_back(0);
+        for (auto& label : labels) {
+            flat_labels.entries.insert(flat_labels.entries.end(), label.begin(), label.end());
+            flat_labels.offsets.push_back(static_cast<uint32_t>(flat_labels.entries.size()));
+            std::vector<LabelEntry>().swap(label);
+        }
+        return flat_labels;
+    }
+
+    template <typename Weight>
+    void HubLabelRouter<Weight>::CheckLabels(const Labels& labels) const {
+        const size_t vertex_count = graph_.GetVertexCount();
+        const size_t edge_count = graph_.GetEdgeCount();
+        if (labels.offsets.size() != vertex_count + 1 || labels.offsets.front() != 0
+            || labels.offsets.back() != labels.entries.size()) {
+            throw std::invalid_argument("Hub labels don't match the graph");
+        }
+        for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+            if (labels.offsets[vertex] > labels.offsets[vertex + 1]) {
+                throw std::invalid_argument("Hub label offsets are not sorted");
+            }
+            for (uint32_t i = labels.offsets[vertex]; i < labels.offsets[vertex + 1]; ++i) {
+                const LabelEntry& entry = labels.entries[i];
+                if (entry.hub >= vertex_count || (entry.edge != NO_EDGE && entry.edge >= edge_count)
+                    || (i > labels.offsets[vertex] && labels.entries[i - 1].hub >= entry.hub)) {
+                    throw std::invalid_argument("Hub label entry is malformed");
+                }
+            }
+        }
+    }
+
+    template <typename Weight>
+    const typename HubLabelRouter<Weight>::LabelEntry& HubLabelRouter<Weight>::FindEntry(const Labels& labels,
+        VertexId vertex, uint32_t hub) const {
+        const auto begin = labels.entries.begin() + labels.offsets[vertex];
+        const auto end = labels.entries.begin() + labels.offsets[vertex + 1];
+        const auto it = std::lower_bound(begin, end, hub,
+            [](const LabelEntry& entry, uint32_t value) { return entry.hub < value; });
+        if (it == end || it->hub != hub) {
+            throw std::logic_error("Hub label path is broken");
+        }
+        return *it;
+    }
+
+}  // namespace graph
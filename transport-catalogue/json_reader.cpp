@@ -46,9 +46,12 @@ void JsonReader::FillCatalogue(transport::Catalogue& catalogue) const {
             ParseBusAddRequest(request_map, buses_info);
         }
     }
+    catalogue.IndexStops();
     SetStopsDistances(catalogue, stop_to_stops_distance);
     BusesAddProcess(catalogue, buses_info);
+    catalogue.IndexBuses();
     SetFinals(catalogue, buses_info);
+    catalogue.ComputeBusStats();
 }
 
 void JsonReader::ParseStopAddRequest(transport::Catalogue& catalogue, const json::Dict& request_map,
@@ -65,9 +68,15 @@ void JsonReader::ParseStopAddRequest(transport::Catalogue& catalogue, const json
 
 void JsonReader::SetStopsDistances(transport::Catalogue& catalogue,
     const StopsDistMap& stop_to_stops_distance) const {
+    size_t distance_count = 0;
     for (const auto& [stop, near_stops] : stop_to_stops_distance) {
+        distance_count += near_stops.size();
+    }
+    catalogue.ReserveDistances(distance_count);
+    for (const auto& [stop, near_stops] : stop_to_stops_distance) {
+        const domain::StopId from = catalogue.FindStop(stop)->id;
         for (const auto& [stop_name, dist] : near_stops) {
-            catalogue.SetDistance(catalogue.FindStop(stop), catalogue.FindStop(stop_name), dist);
+            catalogue.SetDistance(from, catalogue.FindStop(stop_name)->id, dist);
         }
     }
 }
@@ -98,13 +107,13 @@ void JsonReader::ParseBusAddRequest(const json::Dict& request_map, BusesInfoMap&
 
 void JsonReader::BusesAddProcess(transport::Catalogue& catalogue, const BusesInfoMap& buses_info) const {
     for (const auto& [name, info] : buses_info) {
-        vector<transport::Stop*> stop_ptrs;
+        vector<domain::StopId> stop_ids;
         const auto& stops = info.stops;
-        stop_ptrs.reserve(stops.size());
+        stop_ids.reserve(stops.size());
         for (const auto& stop : stops) {
-            stop_ptrs.push_back(catalogue.FindStop(stop));
+            stop_ids.push_back(catalogue.FindStop(stop)->id);
         }
-        catalogue.AddBus(static_cast<string>(name), stop_ptrs, info.is_circle);
+        catalogue.AddBus(static_cast<string>(name), stop_ids, info.is_circle);
     }
 }
 
@@ -112,7 +121,7 @@ void JsonReader::SetFinals(transport::Catalogue& catalogue, const BusesInfoMap&
     for (auto& [bus_name, info] : buses_info) {
         if (domain::Bus* bus = catalogue.FindBus(bus_name)) {
             if (domain::Stop* stop = catalogue.FindStop(info.final_stop)) {
-                bus->final_stop = stop;
+                catalogue.SetFinalStop(bus->id, stop->id);
             }
         }
     }
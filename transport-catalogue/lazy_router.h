@@ -0,0 +1,336 @@
+#pragma once
+
+#include "frozen_graph.h"
+#include "graph.h"
+#include "router.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <list>
+#include <optional>
+#include <queue>
+#include <stdexcept>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+    // Answers routes with Dijkstra from the source vertex on demand.
+    // Shortest-path trees are kept in an LRU cache bounded by memory size.
+    // Given points of the vertices, runs A* from the source to the target instead and caches nothing:
+    // the lower bound is the straight line distance to the target times the least weight per unit
+    // of distance over all edges, so it never overestimates and never drops by more than an edge weight.
+    // Not thread-safe: BuildRoute updates the cache and the search buffers.
+    template <typename Weight>
+    class LazyRouter final : public RouterEngine<Weight> {
+    private:
+        using Graph = DirectedWeightedGraph<Weight>;
+        using ArcId = typename FrozenGraph<Weight>::ArcId;
+
+    public:
+        using typename RouterEngine<Weight>::RouteInfo;
+        using typename RouterEngine<Weight>::WeightMatrix;
+
+        using Point = std::array<double, 3>;
+
+        LazyRouter(const Graph& graph, size_t cache_memory_limit);
+        LazyRouter(const Graph& graph, std::vector<Point> vertex_points);
+
+        std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const override;
+
+        // One full tree per source, A* gives way to it here
+        WeightMatrix BuildWeightMatrix(const std::vector<VertexId>& sources,
+            const std::vector<VertexId>& targets) const override;
+
+        // Drops the cached trees the changed edges can affect: the ones holding a changed edge
+        // and the ones a lighter edge would shorten. A* gets its bound factor again.
+        bool UpdateEdgeWeights(const std::unordered_map<EdgeId, Weight>& previous_weights) override;
+
+    private:
+        static constexpr Weight ZERO_WEIGHT{};
+        static constexpr Weight UNREACHABLE = std::numeric_limits<Weight>::max();
+        static constexpr EdgeId NO_EDGE = std::numeric_limits<EdgeId>::max();
+
+        struct ShortestPathTree {
+            std::vector<Weight> weights;
+            std::vector<EdgeId> prev_edges;
+        };
+
+        using LruList = std::list<VertexId>;
+
+        struct CacheEntry {
+            ShortestPathTree tree;
+            typename LruList::iterator lru_position;
+        };
+
+        // Weights and bounds of the vertices reached by the last A* search
+        struct SearchState {
+            std::vector<Weight> weights;
+            std::vector<Weight> bounds;
+            std::vector<EdgeId> prev_edges;
+            std::vector<VertexId> touched;
+        };
+
+        void CheckWeights() const;
+        void ComputeWeightPerDistance();
+        const ShortestPathTree& GetTree(VertexId from) const;
+        ShortestPathTree BuildTree(VertexId from) const;
+        std::optional<RouteInfo> BuildGoalDirectedRoute(VertexId from, VertexId to) const;
+        static double GetDistance(const Point& from, const Point& to);
+
+        const Graph& graph_;
+        FrozenGraph<Weight> frozen_graph_;
+        std::vector<Point> vertex_points_;
+        double weight_per_distance_ = 0.0;
+        mutable SearchState search_state_;
+        size_t max_cached_trees_ = 1;
+        mutable LruList lru_;
+        mutable std::unordered_map<VertexId, CacheEntry> cache_;
+    };
+
+    template <typename Weight>
+    LazyRouter<Weight>::LazyRouter(const Graph& graph, size_t cache_memory_limit)
+        : graph_(graph)
+        , frozen_graph_(graph) {
+        CheckWeights();
+        const size_t vertex_count = graph.GetVertexCount();
+        const size_t tree_size = std::max<size_t>(vertex_count * (sizeof(Weight) + sizeof(EdgeId)), 1);
+        max_cached_trees_ = std::max<size_t>(cache_memory_limit / tree_size, 1);
+    }
+
+    template <typename Weight>
+    LazyRouter<Weight>::LazyRouter(const Graph& graph, std::vector<Point> vertex_points)
+        : graph_(graph)
+        , frozen_graph_(graph)
+        , vertex_points_(std::move(vertex_points)) {
+        CheckWeights();
+        const size_t vertex_count = graph.GetVertexCount();
+        if (vertex_points_.size() != vertex_count) {
+            throw std::invalid_argument("Every vertex needs a point");
+        }
+        ComputeWeightPerDistance();
+        search_state_.weights.assign(vertex_count, UNREACHABLE);
+        search_state_.bounds.assign(vertex_count, ZERO_WEIGHT);
+        search_state_.prev_edges.assign(vertex_count, NO_EDGE);
+    }
+
+    template <typename Weight>
+    std::optional<typename LazyRouter<Weight>::RouteInfo> LazyRouter<Weight>::BuildRoute(VertexId from,
+        VertexId to) const {
+        if (from >= graph_.GetVertexCount() || to >= graph_.GetVertexCount()) {
+            throw std::out_of_range("Vertex id is out of range");
+        }
+        if (!vertex_points_.empty()) {
+            return BuildGoalDirectedRoute(from, to);
+        }
+        const ShortestPathTree& tree = GetTree(from);
+        if (tree.weights[to] == UNREACHABLE) {
+            return std::nullopt;
+        }
+        std::vector<EdgeId> edges;
+        for (EdgeId edge_id = tree.prev_edges[to]; edge_id != NO_EDGE;
+            edge_id = tree.prev_edges[graph_.GetEdge(edge_id).from]) {
+            edges.push_back(edge_id);
+        }
+        std::reverse(edges.begin(), edges.end());
+
+        return RouteInfo{ tree.weights[to], std::move(edges) };
+    }
+
+    template <typename Weight>
+    typename LazyRouter<Weight>::WeightMatrix LazyRouter<Weight>::BuildWeightMatrix(
+        const std::vector<VertexId>& sources, const std::vector<VertexId>& targets) const {
+        const size_t vertex_count = graph_.GetVertexCount();
+        WeightMatrix matrix;
+        matrix.reserve(sources.size() * targets.size());
+        std::optional<ShortestPathTree> uncached_tree;
+        for (const VertexId from : sources) {
+            if (from >= vertex_count) {
+                throw std::out_of_range("Vertex id is out of range");
+            }
+            if (!vertex_points_.empty()) {
+                uncached_tree = BuildTree(from);
+            }
+            const ShortestPathTree& tree = uncached_tree ? *uncached_tree : GetTree(from);
+            for (const VertexId to : targets) {
+                if (to >= vertex_count) {
+                    throw std::out_of_range("Vertex id is out of range");
+                }
+                matrix.push_back(tree.weights[to] == UNREACHABLE ? std::nullopt
+                    : std::optional<Weight>(tree.weights[to]));
+            }
+        }
+        return matrix;
+    }
+
+    template <typename Weight>
+    bool LazyRouter<Weight>::UpdateEdgeWeights(const std::unordered_map<EdgeId, Weight>& previous_weights) {
+        frozen_graph_ = FrozenGraph<Weight>(graph_);
+        CheckWeights();
+        if (!vertex_points_.empty()) {
+            ComputeWeightPerDistance();
+            return true;
+        }
+        auto is_stale = [&](const ShortestPathTree& tree) {
+            for (const auto& [edge_id, previous_weight] : previous_weights) {
+                const Edge<Weight>& edge = graph_.GetEdge(edge_id);
+                if (tree.prev_edges[edge.to] == edge_id) {
+                    return true;
+                }
+                if (tree.weights[edge.from] != UNREACHABLE && tree.weights[edge.from] + edge.weight < tree.weights[edge.to]) {
+                    return true;
+                }
+            }
+            return false;
+        };
+        for (auto it = cache_.begin(); it != cache_.end();) {
+            if (is_stale(it->second.tree)) {
+                lru_.erase(it->second.lru_position);
+                it = cache_.erase(it);
+            }
+            else {
+                ++it;
+            }
+        }
+        return true;
+    }
+
+    template <typename Weight>
+    void LazyRouter<Weight>::CheckWeights() const {
+        for (ArcId arc = 0; arc < frozen_graph_.GetArcCount(); ++arc) {
+            if (frozen_graph_.GetArcWeight(arc) < ZERO_WEIGHT) {
+                throw std::domain_error("Edges' weights should be non-negative");
+            }
+        }
+    }
+
+    // The bound holds for any placement of the vertices, a poor one only makes it weaker.
+    // The factor is shrunk a little, so that rounding doesn't push the bound over a path weight.
+    template <typename Weight>
+    void LazyRouter<Weight>::ComputeWeightPerDistance() {
+        weight_per_distance_ = std::numeric_limits<double>::infinity();
+        for (ArcId arc = 0; arc < frozen_graph_.GetArcCount(); ++arc) {
+            const Edge<Weight>& edge = graph_.GetEdge(frozen_graph_.GetArcEdgeId(arc));
+            const double distance = GetDistance(vertex_points_[edge.from], vertex_points_[edge.to]);
+            if (distance > 0.0) {
+                weight_per_distance_ = std::min(weight_per_distance_, static_cast<double>(edge.weight) / distance);
+            }
+        }
+        weight_per_distance_ = std::isfinite(weight_per_distance_) ? weight_per_distance_ * (1.0 - 1e-9) : 0.0;
+    }
+
+    template <typename Weight>
+    const typename LazyRouter<Weight>::ShortestPathTree& LazyRouter<Weight>::GetTree(VertexId from) const {
+        if (auto it = cache_.find(from); it != cache_.end()) {
+            lru_.splice(lru_.begin(), lru_, it->second.lru_position);
+            return it->second.tree;
+        }
+        if (cache_.size() >= max_cached_trees_) {
+            cache_.erase(lru_.back());
+            lru_.pop_back();
+        }
+        lru_.push_front(from);
+        CacheEntry& entry = cache_[from];
+        entry.tree = BuildTree(from);
+        entry.lru_position = lru_.begin();
+        return entry.tree;
+    }
+
+    template <typename Weight>
+    typename LazyRouter<Weight>::ShortestPathTree LazyRouter<Weight>::BuildTree(VertexId from) const {
+        const size_t vertex_count = graph_.GetVertexCount();
+        ShortestPathTree tree{ std::vector<Weight>(vertex_count, UNREACHABLE),
+                               std::vector<EdgeId>(vertex_count, NO_EDGE) };
+
+        using QueueItem = std::pair<Weight, VertexId>;
+        std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<QueueItem>> queue;
+        tree.weights[from] = ZERO_WEIGHT;
+        queue.push({ ZERO_WEIGHT, from });
+        while (!queue.empty()) {
+            const auto [weight, vertex] = queue.top();
+            queue.pop();
+            if (weight > tree.weights[vertex]) continue;
+            const auto [arcs_begin, arcs_end] = frozen_graph_.GetArcs(vertex);
+            for (ArcId arc = arcs_begin; arc < arcs_end; ++arc) {
+                const VertexId vertex_to = frozen_graph_.GetArcTarget(arc);
+                const Weight candidate_weight = weight + frozen_graph_.GetArcWeight(arc);
+                if (candidate_weight < tree.weights[vertex_to]) {
+                    tree.weights[vertex_to] = candidate_weight;
+                    tree.prev_edges[vertex_to] = frozen_graph_.GetArcEdgeId(arc);
+                    queue.push({ candidate_weight, vertex_to });
+                }
+            }
+        }
+        return tree;
+    }
+
+    // A vertex is settled once, as the bound is consistent. The search stops at the target.
+    template <typename Weight>
+    std::optional<typename LazyRouter<Weight>::RouteInfo> LazyRouter<Weight>::BuildGoalDirectedRoute(VertexId from,
+        VertexId to) const {
+        SearchState& state = search_state_;
+        for (const VertexId vertex : state.touched) {
+            state.weights[vertex] = UNREACHABLE;
+            state.prev_edges[vertex] = NO_EDGE;
+        }
+        state.touched.clear();
+
+        const Point& target_point = vertex_points_[to];
+        auto touch = [&](VertexId vertex) {
+            state.touched.push_back(vertex);
+            state.bounds[vertex] = static_cast<Weight>(
+                weight_per_distance_ * GetDistance(vertex_points_[vertex], target_point));
+        };
+
+        // Items are ordered by the weight plus the bound, the weight tells the stale ones
+        using QueueItem = std::tuple<Weight, Weight, VertexId>;
+        std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<QueueItem>> queue;
+        touch(from);
+        state.weights[from] = ZERO_WEIGHT;
+        queue.push({ state.bounds[from], ZERO_WEIGHT, from });
+        while (!queue.empty()) {
+            const auto [estimate, weight, vertex] = queue.top();
+            queue.pop();
+            if (weight > state.weights[vertex]) continue;
+            if (vertex == to) break;
+            const auto [arcs_begin, arcs_end] = frozen_graph_.GetArcs(vertex);
+            for (ArcId arc = arcs_begin; arc < arcs_end; ++arc) {
+                const VertexId vertex_to = frozen_graph_.GetArcTarget(arc);
+                const Weight candidate_weight = weight + frozen_graph_.GetArcWeight(arc);
+                if (candidate_weight < state.weights[vertex_to]) {
+                    if (state.weights[vertex_to] == UNREACHABLE) {
+                        touch(vertex_to);
+                    }
+                    state.weights[vertex_to] = candidate_weight;
+                    state.prev_edges[vertex_to] = frozen_graph_.GetArcEdgeId(arc);
+                    queue.push({ candidate_weight + state.bounds[vertex_to], candidate_weight, vertex_to });
+                }
+            }
+        }
+        if (state.weights[to] == UNREACHABLE) {
+            return std::nullopt;
+        }
+
+        std::vector<EdgeId> edges;
+        for (EdgeId edge_id = state.prev_edges[to]; edge_id != NO_EDGE;
+            edge_id = state.prev_edges[graph_.GetEdge(edge_id).from]) {
+            edges.push_back(edge_id);
+        }
+        std::reverse(edges.begin(), edges.end());
+        return RouteInfo{ state.weights[to], std::move(edges) };
+    }
+
+    template <typename Weight>
+    double LazyRouter<Weight>::GetDistance(const Point& from, const Point& to) {
+        const double dx = from[0] - to[0];
+        const double dy = from[1] - to[1];
+        const double dz = from[2] - to[2];
+        return std::sqrt(dx * dx + dy * dy + dz * dz);
+    }
+
+}  // namespace graph
@@ -48,8 +48,8 @@ int main(int argc, char* argv[]) {
         std::ifstream db_file(input_json.GetSerializationSettings().AsDict().at("file"s).AsString(), std::ios::binary);
         if (db_file) {
             
-            auto [tcat, renderer, router, graph, stop_ids] = Deserialize(db_file);
-            router.SetGraph(std::move(graph), std::move(stop_ids));
+            auto [tcat, renderer, router, graph, stop_ids, routing_data] = Deserialize(db_file);
+            router.SetGraph(std::move(graph), std::move(stop_ids), std::move(routing_data));
             RequestHandler handler(tcat, router, renderer);
             handler.JsonStatRequests(input_json.GetStatRequest(), std::cout);            
      
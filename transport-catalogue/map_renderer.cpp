@@ -60,16 +60,16 @@ namespace renderer {
         }
     }
 
-    std::vector<svg::Polyline> MapRenderer::GetBusLines(const std::map<std::string_view,
-        domain::Bus*>& buses, const SphereProjector& sp) const {
+    std::vector<svg::Polyline> MapRenderer::GetBusLines(const transport::Catalogue& tcat,
+        const SphereProjector& sp) const {
         std::vector<svg::Polyline> result;
         unsigned color_num = 0;
-        for (auto& [bus_name, bus_ptr] : buses) {
-            if (bus_ptr->stops.size() == 0) continue;
+        for (const domain::BusId bus : tcat.GetSortedBuses()) {
+            const transport::Catalogue::StopIdRange stops = tcat.GetBusStops(bus);
+            if (stops.begin() == stops.end()) continue;
             svg::Polyline line;
-            std::vector<geo::Coordinates> points;
-            for (auto stop : bus_ptr->stops) {
-                line.AddPoint(sp(stop->coordinates));
+            for (const domain::StopId stop : stops) {
+                line.AddPoint(sp(tcat.GetStopCoordinates(stop)));
             }
             line.SetFillColor("none"s);
             line.SetStrokeColor(color_palette_[color_num]);
@@ -85,16 +85,19 @@ namespace renderer {
         return result;
     }
 
-    std::vector<svg::Text> MapRenderer::GetBusLabels(const std::map<std::string_view, domain::Bus*>& buses,
+    std::vector<svg::Text> MapRenderer::GetBusLabels(const transport::Catalogue& tcat,
         const SphereProjector& sp) const {
         std::vector<svg::Text> result;
         unsigned color_num = 0;
-        for (auto& [bus_name, bus_ptr] : buses) {
-            if (bus_ptr->stops.size() == 0) continue;
+        for (const domain::BusId bus : tcat.GetSortedBuses()) {
+            const transport::Catalogue::StopIdRange stops = tcat.GetBusStops(bus);
+            if (stops.begin() == stops.end()) continue;
+            const domain::StopId first_stop = *stops.begin();
+            const domain::StopId final_stop = tcat.GetFinalStop(bus);
             svg::Text text_underlayer;
             svg::Text text;
-            text_underlayer.SetData(bus_ptr->name);
-            text.SetData(bus_ptr->name);
+            text_underlayer.SetData(std::string(tcat.GetBusName(bus)));
+            text.SetData(std::string(tcat.GetBusName(bus)));
             text.SetFillColor(color_palette_[color_num]);
             if (color_num < (color_palette_.size() - 1)) {
                 ++color_num;
@@ -113,15 +116,15 @@ namespace renderer {
             text_underlayer.SetStrokeWidth(underlayer_width_);
             text_underlayer.SetStrokeLineCap(svg::StrokeLineCap::ROUND);
             text_underlayer.SetStrokeLineJoin(svg::StrokeLineJoin::ROUND);
-            text.SetPosition(sp(bus_ptr->stops[0]->coordinates));
-            text_underlayer.SetPosition(sp(bus_ptr->stops[0]->coordinates));
+            text.SetPosition(sp(tcat.GetStopCoordinates(first_stop)));
+            text_underlayer.SetPosition(sp(tcat.GetStopCoordinates(first_stop)));
             result.push_back(text_underlayer);
             result.push_back(text);
-            if ((!bus_ptr->is_circle) && (bus_ptr->final_stop) && (bus_ptr->final_stop->name != bus_ptr->stops[0]->name)) {
+            if ((!tcat.IsCircle(bus)) && (final_stop != domain::NO_STOP) && (final_stop != first_stop)) {
                 svg::Text text2 = text;
                 svg::Text text2_underlayer = text_underlayer;
-                text2.SetPosition(sp(bus_ptr->final_stop->coordinates));
-                text2_underlayer.SetPosition(sp(bus_ptr->final_stop->coordinates));
+                text2.SetPosition(sp(tcat.GetStopCoordinates(final_stop)));
+                text2_underlayer.SetPosition(sp(tcat.GetStopCoordinates(final_stop)));
                 result.push_back(text2_underlayer);
                 result.push_back(text2);
             }
@@ -129,22 +132,23 @@ namespace renderer {
         return result;
     }
 
-    std::vector<svg::Text> MapRenderer::GetStopLabels(const std::map<std::string_view, domain::Stop*>& stops,
-    const SphereProjector& sp) const {
+    std::vector<svg::Text> MapRenderer::GetStopLabels(const transport::Catalogue& tcat,
+        const std::vector<domain::StopId>& stops, const SphereProjector& sp) const {
         std::vector<svg::Text> result;
-        for (auto& [stop_name, stop_ptr] : stops) {
+        for (const domain::StopId stop : stops) {
+            const std::string name(tcat.GetStopName(stop));
             svg::Text text, text_underlayer;
-            text.SetPosition(sp(stop_ptr->coordinates));
+            text.SetPosition(sp(tcat.GetStopCoordinates(stop)));
             text.SetOffset(stop_label_offset_);
             text.SetFontSize(stop_label_font_size_);
             text.SetFontFamily("Verdana"s);
-            text.SetData(stop_ptr->name);
+            text.SetData(name);
             text.SetFillColor("black"s);
-            text_underlayer.SetPosition(sp(stop_ptr->coordinates));
+            text_underlayer.SetPosition(sp(tcat.GetStopCoordinates(stop)));
             text_underlayer.SetOffset(stop_label_offset_);
             text_underlayer.SetFontSize(stop_label_font_size_);
             text_underlayer.SetFontFamily("Verdana"s);
-            text_underlayer.SetData(stop_ptr->name);
+            text_underlayer.SetData(name);
             text_underlayer.SetFillColor(underlayer_color_);
             text_underlayer.SetStrokeColor(underlayer_color_);
             text_underlayer.SetStrokeWidth(underlayer_width_);
@@ -156,12 +160,12 @@ namespace renderer {
         return result;
     }
 
-    std::vector<svg::Circle> MapRenderer::GetStopCircles(const std::map<std::string_view, domain::Stop*>& stops,
-        const SphereProjector& sp) const {
+    std::vector<svg::Circle> MapRenderer::GetStopCircles(const transport::Catalogue& tcat,
+        const std::vector<domain::StopId>& stops, const SphereProjector& sp) const {
         std::vector<svg::Circle> result;
-        for (auto& [stop_name, stop_ptr] : stops) {
+        for (const domain::StopId stop : stops) {
             svg::Circle circle;
-            circle.SetCenter(sp(stop_ptr->coordinates));
+            circle.SetCenter(sp(tcat.GetStopCoordinates(stop)));
             circle.SetRadius(stop_radius_);
             circle.SetFillColor("white"s);
             result.push_back(circle);
@@ -169,28 +173,37 @@ namespace renderer {
         return result;
     }
 
-    svg::Document MapRenderer::GetSvgDocument(const std::map<std::string_view, domain::Bus*>& buses) const {
-        std::map<std::string_view, domain::Stop*> all_stops;
+    // Only the stops on routes are drawn, in the order of names
+    svg::Document MapRenderer::GetSvgDocument(const transport::Catalogue& tcat) const {
+        std::vector<bool> is_on_route(tcat.GetStopCount(), false);
         std::vector<geo::Coordinates> all_coords;
         svg::Document result;
-        for (const auto& [bus_name, bus_ptr] : buses) {
-            if (bus_ptr->stops.size() == 0) continue;
-            for (const auto& stop : bus_ptr->stops) {
-                all_stops[stop->name] = stop;
-                all_coords.push_back(stop->coordinates);
+        for (domain::BusId bus = 0; bus < tcat.GetBusCount(); ++bus) {
+            for (const domain::StopId stop : tcat.GetBusStops(bus)) {
+                if (!is_on_route[stop]) {
+                    is_on_route[stop] = true;
+                    all_coords.push_back(tcat.GetStopCoordinates(stop));
+                }
+            }
+        }
+        std::vector<domain::StopId> all_stops;
+        all_stops.reserve(all_coords.size());
+        for (const domain::StopId stop : tcat.GetSortedStops()) {
+            if (is_on_route[stop]) {
+                all_stops.push_back(stop);
             }
         }
         SphereProjector sp(all_coords.begin(), all_coords.end(), width_, height_, padding_);
-        for (const auto& line : GetBusLines(buses, sp)) {
+        for (const auto& line : GetBusLines(tcat, sp)) {
             result.Add(line);
         }
-        for (const auto& text : GetBusLabels(buses, sp)) {
+        for (const auto& text : GetBusLabels(tcat, sp)) {
             result.Add(text);
         }
-        for (const auto& circle : GetStopCircles(all_stops, sp)) {
+        for (const auto& circle : GetStopCircles(tcat, all_stops, sp)) {
             result.Add(circle);
         }
-        for (const auto& text : GetStopLabels(all_stops, sp)) {
+        for (const auto& text : GetStopLabels(tcat, all_stops, sp)) {
             result.Add(text);
         }
         return result;
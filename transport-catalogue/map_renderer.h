@@ -4,6 +4,7 @@
 #include "svg.h"
 #include "json.h"
 #include "domain.h"
+#include "transport_catalogue.h"
 
 #include <vector>
 #include <string>
@@ -23,15 +24,17 @@ namespace renderer {
 
         MapRenderer(const json::Node& render_settings);
 
-        std::vector<svg::Polyline> GetBusLines(const std::map<std::string_view, domain::Bus*>& buses, const SphereProjector& sp) const;
+        std::vector<svg::Polyline> GetBusLines(const transport::Catalogue& tcat, const SphereProjector& sp) const;
 
-        std::vector<svg::Text> GetBusLabels(const std::map<std::string_view, domain::Bus*>& buses, const SphereProjector& sp) const;
+        std::vector<svg::Text> GetBusLabels(const transport::Catalogue& tcat, const SphereProjector& sp) const;
 
-        std::vector<svg::Text> GetStopLabels(const std::map<std::string_view, domain::Stop*>& stops, const SphereProjector& sp) const;
+        std::vector<svg::Text> GetStopLabels(const transport::Catalogue& tcat, const std::vector<domain::StopId>& stops,
+            const SphereProjector& sp) const;
 
-        std::vector<svg::Circle> GetStopCircles(const std::map<std::string_view, domain::Stop*>& stops, const SphereProjector& sp) const;
+        std::vector<svg::Circle> GetStopCircles(const transport::Catalogue& tcat, const std::vector<domain::StopId>& stops,
+            const SphereProjector& sp) const;
 
-        svg::Document GetSvgDocument(const std::map<std::string_view, domain::Bus*>& buses) const;
+        svg::Document GetSvgDocument(const transport::Catalogue& tcat) const;
 
         json::Node GetRenderSettings() const;
 
@@ -0,0 +1,126 @@
+#include "perfect_hash.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+namespace phf {
+
+    namespace {
+
+        // Average keys per bucket, bigger buckets make the hash smaller but slower to build
+        constexpr size_t BUCKET_SIZE = 3;
+        constexpr uint32_t MAX_BUCKET_SEED = 1 << 20;
+        constexpr int MAX_ATTEMPTS = 16;
+
+        uint64_t Mix(uint64_t value) {
+            value ^= value >> 30;
+            value *= 0xBF58476D1CE4E5B9ull;
+            value ^= value >> 27;
+            value *= 0x94D049BB133111EBull;
+            value ^= value >> 31;
+            return value;
+        }
+
+    } // namespace
+
+    PerfectHash::PerfectHash(const std::vector<std::string_view>& keys)
+        : key_count_(keys.size()) {
+        if (keys.empty()) return;
+        bucket_seeds_.assign(key_count_ / BUCKET_SIZE + 1, 0);
+        // A seed that fails means equal 64-bit hashes of two keys or bad luck, the next one rehashes all keys
+        for (int attempt = 0; attempt < MAX_ATTEMPTS; ++attempt, ++seed_) {
+            std::vector<uint64_t> hashes;
+            hashes.reserve(keys.size());
+            for (const std::string_view key : keys) {
+                hashes.push_back(Hash(key, seed_));
+            }
+            if (TryBuild(hashes)) return;
+        }
+        throw std::invalid_argument("Perfect hash keys are not distinct");
+    }
+
+    PerfectHash::PerfectHash(uint64_t seed, std::vector<uint32_t> bucket_seeds, size_t key_count)
+        : seed_(seed)
+        , bucket_seeds_(std::move(bucket_seeds))
+        , key_count_(key_count) {
+    }
+
+    size_t PerfectHash::GetKeyCount() const {
+        return key_count_;
+    }
+
+    size_t PerfectHash::GetSlot(std::string_view key) const {
+        const uint64_t hash = Hash(key, seed_);
+        return GetSlot(hash, bucket_seeds_[GetBucket(hash)]);
+    }
+
+    uint64_t PerfectHash::GetSeed() const {
+        return seed_;
+    }
+
+    const std::vector<uint32_t>& PerfectHash::GetBucketSeeds() const {
+        return bucket_seeds_;
+    }
+
+    bool PerfectHash::TryBuild(const std::vector<uint64_t>& hashes) {
+        std::vector<std::vector<uint64_t>> buckets(bucket_seeds_.size());
+        for (const uint64_t hash : hashes) {
+            buckets[GetBucket(hash)].push_back(hash);
+        }
+        // Big buckets go first while most slots are free
+        std::vector<size_t> order(buckets.size());
+        for (size_t i = 0; i < order.size(); ++i) {
+            order[i] = i;
+        }
+        std::stable_sort(order.begin(), order.end(), [&buckets](size_t lhs, size_t rhs) {
+            return buckets[lhs].size() > buckets[rhs].size();
+        });
+
+        std::vector<bool> taken(key_count_, false);
+        std::vector<size_t> slots;
+        for (const size_t bucket : order) {
+            if (buckets[bucket].empty()) break;
+            bool placed = false;
+            for (uint32_t bucket_seed = 0; bucket_seed < MAX_BUCKET_SEED && !placed; ++bucket_seed) {
+                slots.clear();
+                placed = true;
+                for (const uint64_t hash : buckets[bucket]) {
+                    const size_t slot = GetSlot(hash, bucket_seed);
+                    if (taken[slot] || std::find(slots.begin(), slots.end(), slot) != slots.end()) {
+                        placed = false;
+                        break;
+                    }
+                    slots.push_back(slot);
+                }
+                if (placed) {
+                    bucket_seeds_[bucket] = bucket_seed;
+                    for (const size_t slot : slots) {
+                        taken[slot] = true;
+                    }
+                }
+            }
+            if (!placed) return false;
+        }
+        return true;
+    }
+
+    // FNV-1a started from the seed, then mixed so that every bit of the key reaches the high bits
+    uint64_t PerfectHash::Hash(std::string_view key, uint64_t seed) {
+        uint64_t hash = 0xCBF29CE484222325ull ^ Mix(seed);
+        for (const char c : key) {
+            hash ^= static_cast<unsigned char>(c);
+            hash *= 0x100000001B3ull;
+        }
+        return Mix(hash);
+    }
+
+    size_t PerfectHash::GetBucket(uint64_t hash) const {
+        return (hash >> 32) % bucket_seeds_.size();
+    }
+
+    size_t PerfectHash::GetSlot(uint64_t hash, uint32_t bucket_seed) const {
+        return Mix(hash + bucket_seed * 0x9E3779B97F4A7C15ull) % key_count_;
+    }
+
+} // namespace phf
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace phf {
+
+    // Minimal perfect hash over a fixed set of distinct keys, hash and displace (CHD) style:
+    // keys are spread over small buckets, and every bucket gets a seed that moves its keys
+    // into free slots. The keys take the slots 0 .. key count - 1 one to one.
+    // A key outside the set gets some slot as well, so the caller compares the key kept there.
+    class PerfectHash {
+    public:
+        PerfectHash() = default;
+
+        explicit PerfectHash(const std::vector<std::string_view>& keys);
+
+        // Restores a hash built for key_count keys
+        PerfectHash(uint64_t seed, std::vector<uint32_t> bucket_seeds, size_t key_count);
+
+        size_t GetKeyCount() const;
+
+        // Not defined for an empty key set
+        size_t GetSlot(std::string_view key) const;
+
+        uint64_t GetSeed() const;
+
+        const std::vector<uint32_t>& GetBucketSeeds() const;
+
+    private:
+        uint64_t seed_ = 0;
+        std::vector<uint32_t> bucket_seeds_;
+        size_t key_count_ = 0;
+
+        bool TryBuild(const std::vector<uint64_t>& hashes);
+        static uint64_t Hash(std::string_view key, uint64_t seed);
+        size_t GetBucket(uint64_t hash) const;
+        size_t GetSlot(uint64_t hash, uint32_t bucket_seed) const;
+    };
+
+} // namespace phf
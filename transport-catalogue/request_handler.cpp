@@ -1,15 +1,16 @@
 #include "request_handler.h"
 
 #include <utility>
+#include <optional>
 #include <sstream>
-#include <unordered_set>
+#include <vector>
 
 using namespace std;
 using namespace transport;
 using namespace domain;
 
-RequestHandler::RequestHandler(const transport::Catalogue& catalogue,
-    const transport::Router& router, const renderer::MapRenderer& renderer)
+RequestHandler::RequestHandler(transport::Catalogue& catalogue,
+    transport::Router& router, const renderer::MapRenderer& renderer)
     : db_(catalogue)
     , router_(router)
     , renderer_(renderer) {}
@@ -37,12 +38,24 @@ void RequestHandler::JsonStatRequests(const json::Node& json_input, std::ostream
             output_array.push_back(BuildRouteRequestProcessing(request_map));
             continue;
         }
+        if (type == "RouteMatrix"s) {
+            output_array.push_back(BuildRouteMatrixRequestProcessing(request_map));
+            continue;
+        }
+        if (type == "Isochrone"s) {
+            output_array.push_back(BuildIsochroneRequestProcessing(request_map));
+            continue;
+        }
+        if (type == "UpdateRoadDistances"s) {
+            output_array.push_back(UpdateRoadDistancesRequestProcessing(request_map));
+            continue;
+        }
     }
     json::Print(json::Document(json::Node(move(output_array))), output);
 }
 
 svg::Document RequestHandler::RenderMap() const {
-    return renderer_.GetSvgDocument(db_.GetSortedAllBuses());
+    return renderer_.GetSvgDocument(db_);
 }
 
 json::Node RequestHandler::FindStopRequestProcessing(const json::Dict& request_map) {
@@ -50,10 +63,10 @@ json::Node RequestHandler::FindStopRequestProcessing(const json::Dict& request_m
     const string& name = request_map.at("name"s).AsString();
     if (const Stop* stop = db_.FindStop(name)) {
         json::Array buses_array;
-        const auto& buses_on_stop = db_.GetBusesOnStop(stop->name);
-        buses_array.reserve(buses_on_stop.size());
-        for (auto& [bus_name, bus] : buses_on_stop) {
-            buses_array.push_back(bus->name);
+        const Catalogue::BusIdRange buses_on_stop = db_.GetBusesOnStop(stop->id);
+        buses_array.reserve(buses_on_stop.end() - buses_on_stop.begin());
+        for (const BusId bus : buses_on_stop) {
+            buses_array.push_back(string(db_.GetBusName(bus)));
         }
         return json::Node(json::Dict{
                 {{"buses"s},{move(buses_array)}},
@@ -72,23 +85,12 @@ json::Node RequestHandler::FindBusRequestProcessing(const json::Dict& request_ma
     int id = request_map.at("id"s).AsInt();
     const string& name = request_map.at("name"s).AsString();
     if (const Bus* bus = db_.FindBus(name)) {
-        int stops_count = bus->stops.size();
-        int distance = 0;
-        double straight_distance = 0.0;
-        for (int i = 1; i < stops_count; ++i) {
-            distance += bus->stops[i - 1]->GetDistance(bus->stops[i]);
-            straight_distance += geo::ComputeDistance(bus->stops[i - 1]->coordinates, bus->stops[i]->coordinates);
-        }
-        double curvature = distance / straight_distance;
-        unordered_set<string> unique_stops_set;
-        for (transport::Stop* s : bus->stops) {
-            unique_stops_set.emplace(s->name);
-        }
-        int unique_stops = unique_stops_set.size();
+        const BusStats& stats = db_.GetBusStats(bus->id);
+        double curvature = stats.route_length / stats.geo_length;
         return json::Node(json::Dict{
-                {{"route_length"s},{distance}},
-                {{"unique_stop_count"s},{unique_stops}},
-                {{"stop_count"s},{stops_count}},
+                {{"route_length"s},{stats.route_length}},
+                {{"unique_stop_count"s},{stats.unique_stop_count}},
+                {{"stop_count"s},{stats.stop_count}},
                 {{"curvature"s},{curvature}},
                 {{"request_id"s},{id}}
             });
@@ -116,12 +118,19 @@ json::Node RequestHandler::BuildRouteRequestProcessing(const json::Dict& request
     int id = request_map.at("id"s).AsInt();
     const string& name_from = request_map.at("from"s).AsString();
     const string& name_to = request_map.at("to"s).AsString();
+    RouteParameters parameters;
+    if (request_map.count("bus_wait_time"s)) {
+        parameters.bus_wait_time = request_map.at("bus_wait_time"s).AsInt();
+    }
+    if (request_map.count("bus_velocity"s)) {
+        parameters.bus_velocity = request_map.at("bus_velocity"s).AsDouble();
+    }
     if (const Stop* stop_from = db_.FindStop(name_from)) {
         if (const Stop* stop_to = db_.FindStop(name_to)) {
-            if (auto ri = router_.GetRouteInfo(stop_from, stop_to)) {
+            if (auto ri = router_.GetRouteInfo(stop_from, stop_to, parameters)) {
                 auto [wieght, edges] = ri.value();
                 return json::Node(json::Dict{
-                    {{"items"s},{router_.GetEdgesItems(edges)}},
+                    {{"items"s},{router_.GetEdgesItems(edges, parameters)}},
                     {{"total_time"s},{wieght}},
                     {{"request_id"s},{id}}
                     });
@@ -132,4 +141,109 @@ json::Node RequestHandler::BuildRouteRequestProcessing(const json::Dict& request
         .Key("error_message"s).Value("not found"s)
         .Key("request_id"s).Value(id)
         .EndDict().Build();
+}
+
+// Unknown stops and missing routes give null cells. Paths are built only for the cells
+// listed in "with_items" as [row, column] pairs.
+json::Node RequestHandler::BuildRouteMatrixRequestProcessing(const json::Dict& request_map) {
+    int id = request_map.at("id"s).AsInt();
+    auto find_stops = [this](const json::Array& names) {
+        vector<const Stop*> stops;
+        stops.reserve(names.size());
+        for (const json::Node& name : names) {
+            stops.push_back(db_.FindStop(name.AsString()));
+        }
+        return stops;
+    };
+    const vector<const Stop*> stops_from = find_stops(request_map.at("from"s).AsArray());
+    const vector<const Stop*> stops_to = find_stops(request_map.at("to"s).AsArray());
+    const vector<optional<double>> route_times = router_.GetRouteTimes(stops_from, stops_to);
+
+    json::Array total_times;
+    total_times.reserve(stops_from.size());
+    for (size_t row = 0; row < stops_from.size(); ++row) {
+        json::Array row_times;
+        row_times.reserve(stops_to.size());
+        for (size_t column = 0; column < stops_to.size(); ++column) {
+            const optional<double>& route_time = route_times[row * stops_to.size() + column];
+            row_times.push_back(route_time ? json::Node(*route_time) : json::Node(nullptr));
+        }
+        total_times.push_back(move(row_times));
+    }
+    json::Dict result{
+        {{"total_times"s},{move(total_times)}},
+        {{"request_id"s},{id}}
+    };
+
+    if (request_map.count("with_items"s)) {
+        json::Array routes;
+        for (const json::Node& cell_node : request_map.at("with_items"s).AsArray()) {
+            const json::Array& cell = cell_node.AsArray();
+            const int row = cell.at(0).AsInt();
+            const int column = cell.at(1).AsInt();
+            if (row < 0 || column < 0 || static_cast<size_t>(row) >= stops_from.size()
+                || static_cast<size_t>(column) >= stops_to.size()
+                || !stops_from[row] || !stops_to[column]) {
+                continue;
+            }
+            if (auto ri = router_.GetRouteInfo(stops_from[row], stops_to[column])) {
+                routes.push_back(json::Node(json::Dict{
+                    {{"row"s},{row}},
+                    {{"column"s},{column}},
+                    {{"items"s},{router_.GetEdgesItems(ri->edges)}},
+                    {{"total_time"s},{ri->weight}}
+                    }));
+            }
+        }
+        result.emplace("routes"s, move(routes));
+    }
+    return json::Node(move(result));
+}
+
+json::Node RequestHandler::BuildIsochroneRequestProcessing(const json::Dict& request_map) {
+    int id = request_map.at("id"s).AsInt();
+    const string& name_from = request_map.at("from"s).AsString();
+    if (const Stop* stop_from = db_.FindStop(name_from)) {
+        json::Array stops;
+        for (const auto& [stop_name, time] : router_.GetReachableStops(stop_from, request_map.at("max_time"s).AsDouble())) {
+            stops.push_back(json::Node(json::Dict{
+                {{"stop_name"s},{string(stop_name)}},
+                {{"time"s},{time}}
+                }));
+        }
+        return json::Node(json::Dict{
+            {{"stops"s},{move(stops)}},
+            {{"request_id"s},{id}}
+            });
+    }
+    return json::Builder{}.StartDict()
+        .Key("error_message"s).Value("not found"s)
+        .Key("request_id"s).Value(id)
+        .EndDict().Build();
+}
+
+// Nothing changes when one of the stops is unknown
+json::Node RequestHandler::UpdateRoadDistancesRequestProcessing(const json::Dict& request_map) {
+    int id = request_map.at("id"s).AsInt();
+    Stop* stop = db_.FindStop(request_map.at("name"s).AsString());
+    vector<pair<Stop*, int>> distances;
+    for (const auto& [stop_name, distance] : request_map.at("road_distances"s).AsDict()) {
+        distances.push_back({ db_.FindStop(stop_name), distance.AsInt() });
+        if (!distances.back().first) {
+            stop = nullptr;
+        }
+    }
+    if (!stop) {
+        return json::Builder{}.StartDict()
+            .Key("error_message"s).Value("not found"s)
+            .Key("request_id"s).Value(id)
+            .EndDict().Build();
+    }
+    for (const auto& [stop_to, distance] : distances) {
+        db_.SetDistance(stop->id, stop_to->id, distance);
+    }
+    return json::Node(json::Dict{
+            {{"edge_count"s},{static_cast<int>(router_.UpdateRoadDistances(db_))}},
+            {{"request_id"s},{id}}
+        });
 }
\ No newline at end of file
@@ -13,20 +13,24 @@
 
 class RequestHandler {
 public:
-    RequestHandler(const transport::Catalogue& catalogue,
-        const transport::Router& router, const renderer::MapRenderer& renderer);
+    // UpdateRoadDistances requests change the catalogue and the router, later requests see the changes
+    RequestHandler(transport::Catalogue& catalogue,
+        transport::Router& router, const renderer::MapRenderer& renderer);
 
     void JsonStatRequests(const json::Node& json_doc, std::ostream& output);
 
     svg::Document RenderMap() const;
 
 private:
-    const transport::Catalogue& db_;
-    const transport::Router& router_;
+    transport::Catalogue& db_;
+    transport::Router& router_;
     const renderer::MapRenderer& renderer_;
 
     json::Node FindStopRequestProcessing(const json::Dict& request_map);
     json::Node FindBusRequestProcessing(const json::Dict& request_map);
     json::Node BuildMapRequestProcessing(const json::Dict& request_map);
     json::Node BuildRouteRequestProcessing(const json::Dict& request_map);
+    json::Node BuildRouteMatrixRequestProcessing(const json::Dict& request_map);
+    json::Node BuildIsochroneRequestProcessing(const json::Dict& request_map);
+    json::Node UpdateRoadDistancesRequestProcessing(const json::Dict& request_map);
 };
\ No newline at end of file
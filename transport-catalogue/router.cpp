@@ -0,0 +1,87 @@
+#include "router.h"
+
+#if defined(__AVX2__) || defined(__SSE2__) || defined(_M_X64)
+#include <immintrin.h>
+#endif
+
+namespace graph {
+
+    namespace {
+
+        using StoredWeight = int32_t;
+
+        constexpr StoredWeight UNREACHABLE = Router<double>::UNREACHABLE;
+
+        // Relaxes count cells of a route table row through one vertex. The candidate via vertex
+        // is the largest of the through vertex and the vias of both route halves.
+        void RelaxRow(StoredWeight* weights, int32_t* vias,
+            const StoredWeight* weights_through, const int32_t* vias_through,
+            StoredWeight weight_to_through, int32_t via_to_through, size_t count) {
+            size_t i = 0;
+#if defined(__AVX2__)
+            const __m256i to_through = _mm256_set1_epi32(weight_to_through);
+            const __m256i via_through = _mm256_set1_epi32(via_to_through);
+            for (; i + 8 <= count; i += 8) {
+                const __m256i weight = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(weights + i));
+                const __m256i via = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(vias + i));
+                const __m256i candidate = _mm256_add_epi32(to_through,
+                    _mm256_loadu_si256(reinterpret_cast<const __m256i*>(weights_through + i)));
+                const __m256i candidate_via = _mm256_max_epi32(via_through,
+                    _mm256_loadu_si256(reinterpret_cast<const __m256i*>(vias_through + i)));
+                const __m256i improved = _mm256_or_si256(_mm256_cmpgt_epi32(weight, candidate),
+                    _mm256_and_si256(_mm256_cmpeq_epi32(weight, candidate), _mm256_cmpgt_epi32(via, candidate_via)));
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(weights + i), _mm256_min_epi32(weight, candidate));
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(vias + i), _mm256_blendv_epi8(via, candidate_via, improved));
+            }
+#elif defined(__SSE2__) || defined(_M_X64)
+            // SSE2 has neither blend nor 32-bit min/max, lanes are selected with and/andnot/or
+            auto select = [](__m128i mask, __m128i if_set, __m128i if_clear) {
+                return _mm_or_si128(_mm_and_si128(mask, if_set), _mm_andnot_si128(mask, if_clear));
+            };
+            const __m128i to_through = _mm_set1_epi32(weight_to_through);
+            const __m128i via_through = _mm_set1_epi32(via_to_through);
+            for (; i + 4 <= count; i += 4) {
+                const __m128i weight = _mm_loadu_si128(reinterpret_cast<const __m128i*>(weights + i));
+                const __m128i via = _mm_loadu_si128(reinterpret_cast<const __m128i*>(vias + i));
+                const __m128i candidate = _mm_add_epi32(to_through,
+                    _mm_loadu_si128(reinterpret_cast<const __m128i*>(weights_through + i)));
+                const __m128i via_through_to = _mm_loadu_si128(reinterpret_cast<const __m128i*>(vias_through + i));
+                const __m128i candidate_via = select(_mm_cmpgt_epi32(via_through, via_through_to), via_through, via_through_to);
+                const __m128i improved = _mm_or_si128(_mm_cmpgt_epi32(weight, candidate),
+                    _mm_and_si128(_mm_cmpeq_epi32(weight, candidate), _mm_cmpgt_epi32(via, candidate_via)));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(weights + i), select(improved, candidate, weight));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(vias + i), select(improved, candidate_via, via));
+            }
+#endif
+            // UNREACHABLE + any finite weight still exceeds every stored value, no check needed
+            for (; i < count; ++i) {
+                const StoredWeight candidate_weight = weight_to_through + weights_through[i];
+                const int32_t candidate_via = std::max(via_to_through, vias_through[i]);
+                if (candidate_weight < weights[i] || (candidate_weight == weights[i] && candidate_via < vias[i])) {
+                    weights[i] = candidate_weight;
+                    vias[i] = candidate_via;
+                }
+            }
+        }
+
+    } // namespace
+
+    void RelaxRouteTableBlock(int32_t* weights, int32_t* vias, size_t vertex_count,
+        VertexRange rows, VertexRange columns, VertexRange through) {
+        const size_t columns_count = columns.end - columns.begin;
+        for (VertexId vertex_through = through.begin; vertex_through < through.end; ++vertex_through) {
+            const StoredWeight* weights_through = weights + vertex_through * vertex_count + columns.begin;
+            const int32_t* vias_through = vias + vertex_through * vertex_count + columns.begin;
+            for (VertexId vertex_from = rows.begin; vertex_from < rows.end; ++vertex_from) {
+                StoredWeight* weights_from = weights + vertex_from * vertex_count;
+                int32_t* vias_from = vias + vertex_from * vertex_count;
+                const StoredWeight weight_to_through = weights_from[vertex_through];
+                if (weight_to_through == UNREACHABLE) continue;
+                RelaxRow(weights_from + columns.begin, vias_from + columns.begin,
+                    weights_through, vias_through, weight_to_through,
+                    std::max(static_cast<int32_t>(vertex_through), vias_from[vertex_through]), columns_count);
+            }
+        }
+    }
+
+} // namespace graph
@@ -1,116 +1,662 @@
 #pragma once
 
+#include "frozen_graph.h"
 #include "graph.h"
+#include "graph_components.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <cmath>
 #include <cstdint>
+#include <functional>
 #include <iterator>
+#include <limits>
 #include <optional>
 #include <stdexcept>
+#include <thread>
 #include <unordered_map>
 #include <utility>
 #include <vector>
 
 namespace graph {
 
+    struct VertexRange {
+        VertexId begin;
+        VertexId end;
+    };
+
+    // Side of the square tile the route table is relaxed by: three tiles of weights
+    // and prev edges stay within L2 cache
+    inline constexpr size_t ROUTE_TABLE_BLOCK_SIZE = 64;
+
+    // Min-plus relaxation of the row-major route table cells rows x columns through the vertices
+    // of the given range, taken in increasing order. Besides the weight every cell keeps its via
+    // vertex: the largest intermediate vertex of the route, NO_VIA for a direct edge. Among routes
+    // of equal weight the one with the smaller via vertex wins, which makes the result independent
+    // of the order tiles are relaxed in. Uses AVX2 or SSE2 when the target supports them.
+    inline constexpr int32_t NO_VIA = -1;
+
+    void RelaxRouteTableBlock(int32_t* weights, int32_t* vias, size_t vertex_count,
+        VertexRange rows, VertexRange columns, VertexRange through);
+
+    // How the all-pairs table is built. FLOYD_WARSHALL is single-threaded, DIJKSTRA runs
+    // one search per source on a pool of threads and pays off on sparse graphs.
+    // Both give the same weights, routes of equal weight may differ.
+    enum class RouteTableBuilder {
+        FLOYD_WARSHALL,
+        DIJKSTRA
+    };
+
     template <typename Weight>
-    class Router {
+    class RouterEngine {
+    public:
+        struct RouteInfo {
+            Weight weight;
+            std::vector<EdgeId> edges;
+        };
+
+        // Row-major sources x targets, the cell [i * targets.size() + j] is the weight
+        // of the route sources[i] -> targets[j], nullopt without a route
+        using WeightMatrix = std::vector<std::optional<Weight>>;
+
+        virtual std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const = 0;
+
+        // Engines override it to share work between the cells, the default builds every route
+        virtual WeightMatrix BuildWeightMatrix(const std::vector<VertexId>& sources,
+            const std::vector<VertexId>& targets) const {
+            WeightMatrix matrix;
+            matrix.reserve(sources.size() * targets.size());
+            for (const VertexId from : sources) {
+                for (const VertexId to : targets) {
+                    const std::optional<RouteInfo> route = BuildRoute(from, to);
+                    matrix.push_back(route ? std::optional<Weight>(route->weight) : std::nullopt);
+                }
+            }
+            return matrix;
+        }
+
+        // Called after the weights of some edges changed in the graph the engine was built on,
+        // previous_weights gives their weights before the change. Returns false when the engine
+        // can't repair its data and has to be built again, which is the default.
+        virtual bool UpdateEdgeWeights(const std::unordered_map<EdgeId, Weight>&) {
+            return false;
+        }
+
+        virtual ~RouterEngine() = default;
+    };
+
+    template <typename Weight>
+    class Router final : public RouterEngine<Weight> {
     private:
         using Graph = DirectedWeightedGraph<Weight>;
+        using ArcId = typename FrozenGraph<Weight>::ArcId;
 
     public:
-        explicit Router(const Graph& graph);
+        using typename RouterEngine<Weight>::RouteInfo;
+        using typename RouterEngine<Weight>::WeightMatrix;
 
-        struct RouteInfo {
-            Weight weight;
-            std::vector<EdgeId> edges;
+        // Route weights are kept as 32-bit fixed-point numbers: weight * weight_scale.
+        // The scale is picked per graph so that any shortest path fits into MAX_ROUTE_WEIGHT.
+        using StoredWeight = int32_t;
+        using StoredEdgeId = uint32_t;
+
+        static constexpr StoredWeight MAX_ROUTE_WEIGHT = (1 << 30) - 1;
+        static constexpr StoredWeight UNREACHABLE = 1 << 30;
+        static constexpr StoredEdgeId NO_EDGE = std::numeric_limits<StoredEdgeId>::max();
+
+        // One row-major square block per component, over its vertices in increasing order: the cell
+        // [block offset + position(from) * block size + position(to)] describes the route from -> to.
+        // Vertices of different components have no route and no cell, so the table takes
+        // the sum of squares of the component sizes.
+        struct RoutesInternalData {
+            size_t vertex_count = 0;
+            double weight_scale = 1.0;
+            std::vector<StoredWeight> weights;
+            std::vector<StoredEdgeId> prev_edges;
         };
 
-        std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
+        // components are FindComponents(graph), usually kept along with the graph
+        Router(const Graph& graph, std::vector<ComponentId> components,
+            RouteTableBuilder builder = RouteTableBuilder::FLOYD_WARSHALL, size_t thread_count = 0);
+        Router(const Graph& graph, std::vector<ComponentId> components, RoutesInternalData routes_internal_data);
+
+        std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const override;
+
+        WeightMatrix BuildWeightMatrix(const std::vector<VertexId>& sources,
+            const std::vector<VertexId>& targets) const override;
+
+        // Repairs only what the changed edges can affect: routes whose shortest-path tree holds
+        // a heavier edge are found again, then every lighter edge relaxes the rows it shortens.
+        // Gives the same weights as a new table, routes of equal weight may differ.
+        // Changes nothing and returns false when the routes could outgrow the fixed-point scale.
+        bool UpdateEdgeWeights(const std::unordered_map<EdgeId, Weight>& previous_weights) override;
+
+        const RoutesInternalData& GetRoutesInternalData() const;
 
     private:
-        struct RouteInternalData {
-            Weight weight;
-            std::optional<EdgeId> prev_edge;
+        // The square of one component, vertices are numbered by their positions in it
+        struct TableBlock {
+            size_t vertex_count;
+            StoredWeight* weights;
+            StoredEdgeId* prev_edges;
         };
-        
-        using RoutesInternalData = std::vector<std::vector<std::optional<RouteInternalData>>>;
 
-        void InitializeRoutesInternalData(const Graph& graph) {
+        static double ComputeWeightScale(const FrozenGraph<Weight>& graph) {
+            // A simple path leaves every vertex at most once, so the sum of the heaviest
+            // outgoing edges bounds every shortest path. Rounding adds at most 1/2 per edge.
             const size_t vertex_count = graph.GetVertexCount();
+            double max_path_weight = 0.0;
             for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
-                routes_internal_data_[vertex][vertex] = RouteInternalData{ ZERO_WEIGHT, std::nullopt };
-                for (const EdgeId edge_id : graph.GetIncidentEdges(vertex)) {
-                    const auto& edge = graph.GetEdge(edge_id);
-                    if (edge.weight < ZERO_WEIGHT) {
-                        throw std::domain_error("Edges' weights should be non-negative");
+                double max_edge_weight = 0.0;
+                const auto [arcs_begin, arcs_end] = graph.GetArcs(vertex);
+                for (ArcId arc = arcs_begin; arc < arcs_end; ++arc) {
+                    max_edge_weight = std::max(max_edge_weight, static_cast<double>(graph.GetArcWeight(arc)));
+                }
+                max_path_weight += max_edge_weight;
+            }
+            const double steps = static_cast<double>(MAX_ROUTE_WEIGHT) - static_cast<double>(vertex_count);
+            if (steps <= 0.0) {
+                throw std::length_error("Graph is too large for the route table");
+            }
+            return max_path_weight > 0.0 ? steps / max_path_weight : 1.0;
+        }
+
+        void SetComponents(std::vector<ComponentId> components) {
+            const size_t vertex_count = graph_.GetVertexCount();
+            if (components.size() != vertex_count) {
+                throw std::invalid_argument("Components don't match the graph");
+            }
+            for (EdgeId edge_id = 0; edge_id < graph_.GetEdgeCount(); ++edge_id) {
+                const Edge<Weight>& edge = graph_.GetEdge(edge_id);
+                if (components[edge.from] != components[edge.to]) {
+                    throw std::invalid_argument("Components don't match the graph");
+                }
+            }
+            vertex_components_ = std::move(components);
+            vertex_positions_.resize(vertex_count);
+            component_sizes_.clear();
+            for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+                const ComponentId component = vertex_components_[vertex];
+                if (component >= component_sizes_.size()) {
+                    component_sizes_.resize(component + 1, 0);
+                }
+                vertex_positions_[vertex] = component_sizes_[component]++;
+            }
+            component_offsets_.assign(1, 0);
+            for (const size_t size : component_sizes_) {
+                component_offsets_.push_back(component_offsets_.back() + size * size);
+            }
+        }
+
+        // The cell from -> to is the row offset plus the position of to, if both share the component
+        size_t GetRowOffset(VertexId from) const {
+            const ComponentId component = vertex_components_[from];
+            return component_offsets_[component] + vertex_positions_[from] * component_sizes_[component];
+        }
+
+        TableBlock GetTableBlock(ComponentId component) {
+            auto& data = routes_internal_data_;
+            const size_t offset = component_offsets_[component];
+            return { component_sizes_[component], data.weights.data() + offset, data.prev_edges.data() + offset };
+        }
+
+        // Allocates the table with the diagonal filled and returns rounded arc weights
+        std::vector<StoredWeight> InitializeRoutesInternalData(const FrozenGraph<Weight>& graph) {
+            const size_t vertex_count = graph.GetVertexCount();
+            if (graph.GetArcCount() >= NO_EDGE
+                || vertex_count > static_cast<size_t>(std::numeric_limits<int32_t>::max())) {
+                throw std::length_error("Graph is too large for the route table");
+            }
+            auto& data = routes_internal_data_;
+            data.vertex_count = vertex_count;
+            data.weight_scale = ComputeWeightScale(graph);
+            data.weights.assign(component_offsets_.back(), UNREACHABLE);
+            data.prev_edges.assign(component_offsets_.back(), NO_EDGE);
+            for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+                data.weights[GetRowOffset(vertex) + vertex_positions_[vertex]] = 0;
+            }
+            std::vector<StoredWeight> arc_weights(graph.GetArcCount());
+            for (ArcId arc = 0; arc < arc_weights.size(); ++arc) {
+                const Weight weight = graph.GetArcWeight(arc);
+                if (weight < ZERO_WEIGHT) {
+                    throw std::domain_error("Edges' weights should be non-negative");
+                }
+                arc_weights[arc] = static_cast<StoredWeight>(
+                    std::llround(static_cast<double>(weight) * data.weight_scale));
+            }
+            return arc_weights;
+        }
+
+        // Routes of the row from that hold a heavier edge are found again, the others stay: heavier edges
+        // can't shorten them. Every stale vertex starts from its best arc out of the rest of the tree,
+        // then Dijkstra runs over the stale vertices only. is_stale is a scratch buffer by position.
+        void RepairRouteTableRow(VertexId from, const FrozenGraph<Weight>& forward_graph,
+            const FrozenGraph<Weight>& backward_graph, const std::vector<StoredWeight>& edge_weights,
+            const std::vector<bool>& is_increased, std::vector<int8_t>& is_stale,
+            std::vector<std::pair<StoredWeight, VertexId>>& heap) {
+            constexpr int8_t UNKNOWN = -1;
+            auto& data = routes_internal_data_;
+            StoredWeight* weights_from = data.weights.data() + GetRowOffset(from);
+            StoredEdgeId* prev_edges_from = data.prev_edges.data() + GetRowOffset(from);
+            const size_t size = component_sizes_[vertex_components_[from]];
+            is_stale.assign(size, UNKNOWN);
+            std::vector<size_t> chain;
+            std::vector<VertexId> stale_vertices;
+            for (size_t position = 0; position < size; ++position) {
+                if (weights_from[position] == UNREACHABLE) continue;
+                size_t chain_position = position;
+                while (is_stale[chain_position] == UNKNOWN) {
+                    const StoredEdgeId edge_id = prev_edges_from[chain_position];
+                    if (edge_id == NO_EDGE || is_increased[edge_id]) {
+                        is_stale[chain_position] = edge_id != NO_EDGE;
+                        break;
                     }
-                    auto& route_internal_data = routes_internal_data_[vertex][edge.to];
-                    if (!route_internal_data || route_internal_data->weight > edge.weight) {
-                        route_internal_data = RouteInternalData{ edge.weight, edge_id };
+                    chain.push_back(chain_position);
+                    chain_position = vertex_positions_[graph_.GetEdge(edge_id).from];
+                }
+                for (const size_t resolved_position : chain) {
+                    is_stale[resolved_position] = is_stale[chain_position];
+                }
+                chain.clear();
+                if (is_stale[position] == 1) {
+                    stale_vertices.push_back(graph_.GetEdge(prev_edges_from[position]).to);
+                }
+            }
+
+            for (const VertexId vertex : stale_vertices) {
+                weights_from[vertex_positions_[vertex]] = UNREACHABLE;
+                prev_edges_from[vertex_positions_[vertex]] = NO_EDGE;
+            }
+            const auto heap_order = std::greater<std::pair<StoredWeight, VertexId>>{};
+            heap.clear();
+            for (const VertexId vertex : stale_vertices) {
+                const size_t position = vertex_positions_[vertex];
+                const auto [arcs_begin, arcs_end] = backward_graph.GetArcs(vertex);
+                for (ArcId arc = arcs_begin; arc < arcs_end; ++arc) {
+                    const size_t position_from = vertex_positions_[backward_graph.GetArcTarget(arc)];
+                    if (is_stale[position_from] == 1 || weights_from[position_from] == UNREACHABLE) continue;
+                    const EdgeId edge_id = backward_graph.GetArcEdgeId(arc);
+                    const StoredWeight candidate_weight = weights_from[position_from] + edge_weights[edge_id];
+                    if (candidate_weight < weights_from[position]) {
+                        weights_from[position] = candidate_weight;
+                        prev_edges_from[position] = static_cast<StoredEdgeId>(edge_id);
                     }
                 }
+                if (weights_from[position] != UNREACHABLE) {
+                    heap.push_back({ weights_from[position], vertex });
+                }
+            }
+            std::make_heap(heap.begin(), heap.end(), heap_order);
+            while (!heap.empty()) {
+                std::pop_heap(heap.begin(), heap.end(), heap_order);
+                const auto [weight, vertex] = heap.back();
+                heap.pop_back();
+                if (weight > weights_from[vertex_positions_[vertex]]) continue;
+                const auto [arcs_begin, arcs_end] = forward_graph.GetArcs(vertex);
+                for (ArcId arc = arcs_begin; arc < arcs_end; ++arc) {
+                    const size_t position_to = vertex_positions_[forward_graph.GetArcTarget(arc)];
+                    if (is_stale[position_to] != 1) continue;
+                    const EdgeId edge_id = forward_graph.GetArcEdgeId(arc);
+                    const StoredWeight candidate_weight = weight + edge_weights[edge_id];
+                    if (candidate_weight < weights_from[position_to]) {
+                        weights_from[position_to] = candidate_weight;
+                        prev_edges_from[position_to] = static_cast<StoredEdgeId>(edge_id);
+                        heap.push_back({ candidate_weight, forward_graph.GetArcTarget(arc) });
+                        std::push_heap(heap.begin(), heap.end(), heap_order);
+                    }
+                }
+            }
+        }
+
+        // The table holds all shortest routes of the graph where the edge from -> to weighs more.
+        // Nothing changes unless the lighter edge beats the route from -> to, and then only the rows
+        // that reach to through it. The row of to stays, so it is read while the others are written.
+        void RelaxDecreasedEdge(const Edge<Weight>& edge, EdgeId edge_id, StoredWeight weight) {
+            auto& data = routes_internal_data_;
+            const ComponentId component = vertex_components_[edge.from];
+            const size_t offset = component_offsets_[component];
+            const size_t size = component_sizes_[component];
+            const size_t position_from = vertex_positions_[edge.from];
+            const size_t position_to = vertex_positions_[edge.to];
+            if (weight >= data.weights[offset + position_from * size + position_to]) {
+                return;
+            }
+            const StoredWeight* weights_to = data.weights.data() + offset + position_to * size;
+            const StoredEdgeId* prev_edges_to = data.prev_edges.data() + offset + position_to * size;
+            for (size_t row = 0; row < size; ++row) {
+                StoredWeight* weights_row = data.weights.data() + offset + row * size;
+                StoredEdgeId* prev_edges_row = data.prev_edges.data() + offset + row * size;
+                if (weights_row[position_from] == UNREACHABLE) continue;
+                const int64_t weight_through = int64_t{ weights_row[position_from] } + weight;
+                if (weight_through >= weights_row[position_to]) continue;
+                for (size_t column = 0; column < size; ++column) {
+                    if (weights_to[column] == UNREACHABLE) continue;
+                    const int64_t candidate_weight = weight_through + weights_to[column];
+                    if (candidate_weight < weights_row[column]) {
+                        weights_row[column] = static_cast<StoredWeight>(candidate_weight);
+                        prev_edges_row[column] = column == position_to ? static_cast<StoredEdgeId>(edge_id)
+                            : prev_edges_to[column];
+                    }
+                }
+            }
+        }
+
+        void AddDirectEdges(const FrozenGraph<Weight>& graph, const std::vector<StoredWeight>& arc_weights) {
+            auto& data = routes_internal_data_;
+            const size_t vertex_count = data.vertex_count;
+            for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+                const size_t row_offset = GetRowOffset(vertex);
+                const auto [arcs_begin, arcs_end] = graph.GetArcs(vertex);
+                for (ArcId arc = arcs_begin; arc < arcs_end; ++arc) {
+                    const size_t cell = row_offset + vertex_positions_[graph.GetArcTarget(arc)];
+                    if (data.weights[cell] > arc_weights[arc]) {
+                        data.weights[cell] = arc_weights[arc];
+                        data.prev_edges[cell] = static_cast<StoredEdgeId>(graph.GetArcEdgeId(arc));
+                    }
+                }
+            }
+        }
+
+        // Rows are independent, so each source is handled by one thread with one fixed
+        // Dijkstra order: the table does not depend on the number of threads
+        void BuildRoutesInternalDataByDijkstra(const FrozenGraph<Weight>& graph, const std::vector<StoredWeight>& arc_weights,
+            size_t thread_count) {
+            const size_t vertex_count = routes_internal_data_.vertex_count;
+            if (thread_count == 0) {
+                thread_count = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+            }
+            thread_count = std::min(thread_count, std::max<size_t>(vertex_count, 1));
+            std::atomic<VertexId> next_source{ 0 };
+            auto worker = [&]() {
+                std::vector<std::pair<StoredWeight, VertexId>> heap;
+                for (VertexId from = next_source++; from < vertex_count; from = next_source++) {
+                    BuildRouteTableRow(graph, arc_weights, from, heap);
+                }
+            };
+            std::vector<std::thread> threads;
+            threads.reserve(thread_count - 1);
+            for (size_t i = 1; i < thread_count; ++i) {
+                threads.emplace_back(worker);
+            }
+            worker();
+            for (auto& thread : threads) {
+                thread.join();
             }
         }
 
-        void RelaxRoute(VertexId vertex_from, VertexId vertex_to, const RouteInternalData& route_from,
-            const RouteInternalData& route_to) {
-            auto& route_relaxing = routes_internal_data_[vertex_from][vertex_to];
-            const Weight candidate_weight = route_from.weight + route_to.weight;
-            if (!route_relaxing || candidate_weight < route_relaxing->weight) {
-                route_relaxing = { candidate_weight,
-                                  route_to.prev_edge ? route_to.prev_edge : route_from.prev_edge };
+        // The search never leaves the component of from, so every vertex it reaches has a cell in the row
+        void BuildRouteTableRow(const FrozenGraph<Weight>& graph, const std::vector<StoredWeight>& arc_weights, VertexId from,
+            std::vector<std::pair<StoredWeight, VertexId>>& heap) {
+            auto& data = routes_internal_data_;
+            StoredWeight* weights_from = data.weights.data() + GetRowOffset(from);
+            StoredEdgeId* prev_edges_from = data.prev_edges.data() + GetRowOffset(from);
+            const auto heap_order = std::greater<std::pair<StoredWeight, VertexId>>{};
+            heap.assign(1, { 0, from });
+            while (!heap.empty()) {
+                std::pop_heap(heap.begin(), heap.end(), heap_order);
+                const auto [weight, vertex] = heap.back();
+                heap.pop_back();
+                if (weight > weights_from[vertex_positions_[vertex]]) continue;
+                const auto [arcs_begin, arcs_end] = graph.GetArcs(vertex);
+                for (ArcId arc = arcs_begin; arc < arcs_end; ++arc) {
+                    const VertexId vertex_to = graph.GetArcTarget(arc);
+                    const size_t position_to = vertex_positions_[vertex_to];
+                    const StoredWeight candidate_weight = weight + arc_weights[arc];
+                    if (candidate_weight < weights_from[position_to]) {
+                        weights_from[position_to] = candidate_weight;
+                        prev_edges_from[position_to] = static_cast<StoredEdgeId>(graph.GetArcEdgeId(arc));
+                        heap.push_back({ candidate_weight, vertex_to });
+                        std::push_heap(heap.begin(), heap.end(), heap_order);
+                    }
+                }
             }
         }
 
-        void RelaxRoutesInternalDataThroughVertex(size_t vertex_count, VertexId vertex_through) {
-            for (VertexId vertex_from = 0; vertex_from < vertex_count; ++vertex_from) {
-                if (const auto& route_from = routes_internal_data_[vertex_from][vertex_through]) {
-                    for (VertexId vertex_to = 0; vertex_to < vertex_count; ++vertex_to) {
-                        if (const auto& route_to = routes_internal_data_[vertex_through][vertex_to]) {
-                            RelaxRoute(vertex_from, vertex_to, *route_from, *route_to);
-                        }
+        // Blocked Floyd-Warshall: for every band of intermediate vertices the diagonal tile is relaxed
+        // first, then its row and column tiles, then all the rest
+        static void RelaxTableBlock(const TableBlock& table_block, std::vector<int32_t>& vias) {
+            const size_t vertex_count = table_block.vertex_count;
+            auto relax = [&table_block, &vias](VertexRange rows, VertexRange columns, VertexRange through) {
+                RelaxRouteTableBlock(table_block.weights, vias.data(), table_block.vertex_count, rows, columns, through);
+            };
+            auto block = [vertex_count](VertexId begin) {
+                return VertexRange{ begin, std::min(begin + ROUTE_TABLE_BLOCK_SIZE, vertex_count) };
+            };
+            for (VertexId through_begin = 0; through_begin < vertex_count; through_begin += ROUTE_TABLE_BLOCK_SIZE) {
+                const VertexRange through = block(through_begin);
+                relax(through, through, through);
+                for (VertexId begin = 0; begin < vertex_count; begin += ROUTE_TABLE_BLOCK_SIZE) {
+                    if (begin == through.begin) continue;
+                    relax(through, block(begin), through);
+                    relax(block(begin), through, through);
+                }
+                for (VertexId rows_begin = 0; rows_begin < vertex_count; rows_begin += ROUTE_TABLE_BLOCK_SIZE) {
+                    if (rows_begin == through.begin) continue;
+                    for (VertexId columns_begin = 0; columns_begin < vertex_count; columns_begin += ROUTE_TABLE_BLOCK_SIZE) {
+                        if (columns_begin == through.begin) continue;
+                        relax(block(rows_begin), block(columns_begin), through);
                     }
                 }
             }
         }
 
+        // The last edge of a route from -> to through via vertex is the last edge of via -> to.
+        // Via vertices strictly decrease along such a chain, so it ends at a direct edge.
+        // Gives exactly the prev edges of the textbook vertex-by-vertex relaxation.
+        static void RestorePrevEdges(const TableBlock& table_block, std::vector<int32_t>& vias) {
+            const size_t vertex_count = table_block.vertex_count;
+            std::vector<size_t> chain;
+            for (size_t cell = 0; cell < vias.size(); ++cell) {
+                if (vias[cell] == NO_VIA || table_block.weights[cell] == UNREACHABLE) continue;
+                const VertexId vertex_to = cell % vertex_count;
+                size_t chain_cell = cell;
+                while (vias[chain_cell] != NO_VIA) {
+                    chain.push_back(chain_cell);
+                    chain_cell = static_cast<size_t>(vias[chain_cell]) * vertex_count + vertex_to;
+                }
+                for (const size_t resolved_cell : chain) {
+                    table_block.prev_edges[resolved_cell] = table_block.prev_edges[chain_cell];
+                    vias[resolved_cell] = NO_VIA;
+                }
+                chain.clear();
+            }
+        }
+
         static constexpr Weight ZERO_WEIGHT{};
         const Graph& graph_;
         RoutesInternalData routes_internal_data_;
+        std::vector<ComponentId> vertex_components_;
+        // Position of every vertex among the vertices of its component
+        std::vector<size_t> vertex_positions_;
+        std::vector<size_t> component_sizes_;
+        // First cell of every block, the last one is the size of the table
+        std::vector<size_t> component_offsets_;
     };
 
     template <typename Weight>
-    Router<Weight>::Router(const Graph& graph)
+    Router<Weight>::Router(const Graph& graph, std::vector<ComponentId> components, RouteTableBuilder builder,
+        size_t thread_count)
+        : graph_(graph) {
+        SetComponents(std::move(components));
+        // The graph is only walked while the table is built, BuildRoute needs just the edges
+        const FrozenGraph<Weight> frozen_graph(graph);
+        const std::vector<StoredWeight> arc_weights = InitializeRoutesInternalData(frozen_graph);
+        if (builder == RouteTableBuilder::DIJKSTRA) {
+            BuildRoutesInternalDataByDijkstra(frozen_graph, arc_weights, thread_count);
+            return;
+        }
+        AddDirectEdges(frozen_graph, arc_weights);
+        // Positions follow the vertex order, so every block gets the same vias and ties
+        // as its part of the whole table would
+        std::vector<int32_t> vias;
+        for (ComponentId component = 0; component < component_sizes_.size(); ++component) {
+            const TableBlock table_block = GetTableBlock(component);
+            vias.assign(table_block.vertex_count * table_block.vertex_count, NO_VIA);
+            RelaxTableBlock(table_block, vias);
+            RestorePrevEdges(table_block, vias);
+        }
+    }
+
+    template <typename Weight>
+    Router<Weight>::Router(const Graph& graph, std::vector<ComponentId> components,
+        RoutesInternalData routes_internal_data)
         : graph_(graph)
-        , routes_internal_data_(graph.GetVertexCount(),
-          std::vector<std::optional<RouteInternalData>>(graph.GetVertexCount())) {
-        InitializeRoutesInternalData(graph);
-        const size_t vertex_count = graph.GetVertexCount();
-        for (VertexId vertex_through = 0; vertex_through < vertex_count; ++vertex_through) {
-            RelaxRoutesInternalDataThroughVertex(vertex_count, vertex_through);
+        , routes_internal_data_(std::move(routes_internal_data)) {
+        SetComponents(std::move(components));
+        if (routes_internal_data_.vertex_count != graph.GetVertexCount()
+            || routes_internal_data_.weights.size() != component_offsets_.back()
+            || routes_internal_data_.prev_edges.size() != component_offsets_.back()) {
+            throw std::invalid_argument("Routes data doesn't match the graph");
         }
     }
 
     template <typename Weight>
     std::optional<typename Router<Weight>::RouteInfo> Router<Weight>::BuildRoute(VertexId from,
         VertexId to) const {
-        const auto& route_internal_data = routes_internal_data_.at(from).at(to);
-        if (!route_internal_data) {
+        const size_t vertex_count = routes_internal_data_.vertex_count;
+        if (from >= vertex_count || to >= vertex_count) {
+            throw std::out_of_range("Vertex id is out of range");
+        }
+        if (vertex_components_[from] != vertex_components_[to]) {
+            return std::nullopt;
+        }
+        const size_t row_offset = GetRowOffset(from);
+        const StoredEdgeId* prev_edges_from = routes_internal_data_.prev_edges.data() + row_offset;
+        if (routes_internal_data_.weights[row_offset + vertex_positions_[to]] == UNREACHABLE) {
             return std::nullopt;
         }
-        const Weight weight = route_internal_data->weight;
         std::vector<EdgeId> edges;
-        for (std::optional<EdgeId> edge_id = route_internal_data->prev_edge;
-            edge_id;
-            edge_id = routes_internal_data_[from][graph_.GetEdge(*edge_id).from]->prev_edge)
+        for (StoredEdgeId edge_id = prev_edges_from[vertex_positions_[to]];
+            edge_id != NO_EDGE;
+            edge_id = prev_edges_from[vertex_positions_[graph_.GetEdge(edge_id).from]])
         {
-            edges.push_back(*edge_id);
+            edges.push_back(edge_id);
         }
         std::reverse(edges.begin(), edges.end());
 
+        // The table only keeps rounded weights, the exact one is summed along the path
+        Weight weight = ZERO_WEIGHT;
+        for (const EdgeId edge_id : edges) {
+            weight += graph_.GetEdge(edge_id).weight;
+        }
         return RouteInfo{ weight, std::move(edges) };
     }
 
+    // No search per cell: the table is read and the exact weight is summed along the stored path
+    template <typename Weight>
+    typename Router<Weight>::WeightMatrix Router<Weight>::BuildWeightMatrix(const std::vector<VertexId>& sources,
+        const std::vector<VertexId>& targets) const {
+        const size_t vertex_count = routes_internal_data_.vertex_count;
+        WeightMatrix matrix;
+        matrix.reserve(sources.size() * targets.size());
+        for (const VertexId from : sources) {
+            if (from >= vertex_count) {
+                throw std::out_of_range("Vertex id is out of range");
+            }
+            const size_t row_offset = GetRowOffset(from);
+            const StoredEdgeId* prev_edges_from = routes_internal_data_.prev_edges.data() + row_offset;
+            for (const VertexId to : targets) {
+                if (to >= vertex_count) {
+                    throw std::out_of_range("Vertex id is out of range");
+                }
+                if (vertex_components_[from] != vertex_components_[to]
+                    || routes_internal_data_.weights[row_offset + vertex_positions_[to]] == UNREACHABLE) {
+                    matrix.push_back(std::nullopt);
+                    continue;
+                }
+                Weight weight = ZERO_WEIGHT;
+                for (StoredEdgeId edge_id = prev_edges_from[vertex_positions_[to]];
+                    edge_id != NO_EDGE;
+                    edge_id = prev_edges_from[vertex_positions_[graph_.GetEdge(edge_id).from]])
+                {
+                    weight += graph_.GetEdge(edge_id).weight;
+                }
+                matrix.push_back(weight);
+            }
+        }
+        return matrix;
+    }
+
+    template <typename Weight>
+    bool Router<Weight>::UpdateEdgeWeights(const std::unordered_map<EdgeId, Weight>& previous_weights) {
+        auto& data = routes_internal_data_;
+        auto to_stored_weight = [&data](Weight weight) {
+            if (weight < ZERO_WEIGHT) {
+                throw std::domain_error("Edges' weights should be non-negative");
+            }
+            return std::llround(static_cast<double>(weight) * data.weight_scale);
+        };
+        std::unordered_map<EdgeId, StoredWeight> increased_edges;
+        // Keeps the previous weights
+        std::unordered_map<EdgeId, StoredWeight> decreased_edges;
+        // A shortest route is simple and takes every heavier edge at most once
+        int64_t max_route_weight = 0;
+        for (const StoredWeight weight : data.weights) {
+            if (weight != UNREACHABLE) {
+                max_route_weight = std::max<int64_t>(max_route_weight, weight);
+            }
+        }
+        for (const auto& [edge_id, previous_weight] : previous_weights) {
+            const int64_t stored_weight = to_stored_weight(graph_.GetEdge(edge_id).weight);
+            const int64_t previous_stored_weight = to_stored_weight(previous_weight);
+            if (stored_weight > previous_stored_weight) {
+                max_route_weight += stored_weight - previous_stored_weight;
+                if (max_route_weight > MAX_ROUTE_WEIGHT) {
+                    return false;
+                }
+                // An edge heavier than the route between its ends is in no shortest-path tree
+                const Edge<Weight>& edge = graph_.GetEdge(edge_id);
+                if (previous_stored_weight == data.weights[GetRowOffset(edge.from) + vertex_positions_[edge.to]]) {
+                    increased_edges.emplace(edge_id, static_cast<StoredWeight>(stored_weight));
+                }
+            }
+            else if (stored_weight < previous_stored_weight) {
+                decreased_edges.emplace(edge_id, static_cast<StoredWeight>(previous_stored_weight));
+            }
+        }
+
+        // First the heavier edges alone, the lighter ones still weigh as before
+        if (!increased_edges.empty()) {
+            const size_t edge_count = graph_.GetEdgeCount();
+            std::vector<StoredWeight> edge_weights(edge_count);
+            std::vector<bool> is_increased(edge_count, false);
+            for (EdgeId edge_id = 0; edge_id < edge_count; ++edge_id) {
+                const auto it = decreased_edges.find(edge_id);
+                edge_weights[edge_id] = it != decreased_edges.end() ? it->second
+                    : static_cast<StoredWeight>(to_stored_weight(graph_.GetEdge(edge_id).weight));
+            }
+            for (const auto& increased_edge : increased_edges) {
+                is_increased[increased_edge.first] = true;
+            }
+            const FrozenGraph<Weight> forward_graph(graph_);
+            const FrozenGraph<Weight> backward_graph(graph_, ArcDirection::BACKWARD);
+            std::vector<int8_t> is_stale;
+            std::vector<std::pair<StoredWeight, VertexId>> heap;
+            for (VertexId from = 0; from < data.vertex_count; ++from) {
+                const size_t row_offset = GetRowOffset(from);
+                for (const auto& increased_edge : increased_edges) {
+                    const Edge<Weight>& edge = graph_.GetEdge(increased_edge.first);
+                    if (vertex_components_[edge.to] == vertex_components_[from]
+                        && data.prev_edges[row_offset + vertex_positions_[edge.to]] == increased_edge.first) {
+                        RepairRouteTableRow(from, forward_graph, backward_graph, edge_weights, is_increased,
+                            is_stale, heap);
+                        break;
+                    }
+                }
+            }
+        }
+        // Then the lighter edges one by one, every step keeps the table exact
+        for (const auto& decreased_edge : decreased_edges) {
+            const Edge<Weight>& edge = graph_.GetEdge(decreased_edge.first);
+            RelaxDecreasedEdge(edge, decreased_edge.first, static_cast<StoredWeight>(to_stored_weight(edge.weight)));
+        }
+        return true;
+    }
+
+    template <typename Weight>
+    const typename Router<Weight>::RoutesInternalData& Router<Weight>::GetRoutesInternalData() const {
+        return routes_internal_data_;
+    }
+
 }  // namespace graph
\ No newline at end of file
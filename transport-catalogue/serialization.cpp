@@ -1,47 +1,83 @@
 #include "serialization.h"
 
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
 using namespace std;
 
+// Bump on any change of the stored layouts: stale route tables, hierarchies and labels are rebuilt on load
+const uint32_t ROUTE_TABLE_VERSION = 3;
+const uint32_t CONTRACTION_HIERARCHY_VERSION = 1;
+const uint32_t HUB_LABELS_VERSION = 1;
+
 void Serialize(const transport::Catalogue& tcat,
     const renderer::MapRenderer& renderer, const transport::Router& router,
     std::ostream& output) {
     serialize::TransportCatalogue database;
-    for (const auto& [name, s] : tcat.GetSortedAllStops()) {
-        *database.add_stop() = Serialize(s);
+    std::vector<serialize::Stop*> stops(tcat.GetStopCount());
+    for (const domain::StopId s : tcat.GetSortedStops()) {
+        stops[s] = database.add_stop();
+        *stops[s] = Serialize(tcat, &tcat.GetStop(s));
+    }
+    for (const domain::RoadDistance& road_distance : tcat.GetRoadDistances()) {
+        stops[road_distance.from]->add_near_stop(static_cast<string>(tcat.GetStopName(road_distance.to)));
+        stops[road_distance.from]->add_distance(road_distance.distance);
     }
-    for (const auto& [name, b] : tcat.GetSortedAllBuses()) {
-        *database.add_bus() = Serialize(b);
+    for (const domain::BusId b : tcat.GetSortedBuses()) {
+        *database.add_bus() = Serialize(tcat, &tcat.GetBus(b));
     }
+    *database.mutable_stop_index() = Serialize(tcat.GetStopNameHash(), tcat.GetSlotStops(), tcat.GetSortedStops());
+    *database.mutable_bus_index() = Serialize(tcat.GetBusNameHash(), tcat.GetSlotBuses(), tcat.GetSortedBuses());
     *database.mutable_render_settings() = GetRenderSettingSerialize(renderer.GetRenderSettings());
     *database.mutable_router() = Serialize(router);
     database.SerializeToOstream(&output);
 }
 
-serialize::Stop Serialize(const transport::Stop* stop) {
+serialize::Stop Serialize(const transport::Catalogue& tcat, const transport::Stop* stop) {
     serialize::Stop result;
     result.set_name(stop->name);
-    result.add_coordinate(stop->coordinates.lat);
-    result.add_coordinate(stop->coordinates.lng);
-    for (const auto& [n, d] : stop->stop_distances) {
-        result.add_near_stop(static_cast<string>(n));
-        result.add_distance(d);
-    }
+    const geo::Coordinates& coordinates = tcat.GetStopCoordinates(stop->id);
+    result.add_coordinate(coordinates.lat);
+    result.add_coordinate(coordinates.lng);
     return result;
 }
 
-serialize::Bus Serialize(const transport::Bus* bus) {
+serialize::Bus Serialize(const transport::Catalogue& tcat, const transport::Bus* bus) {
     serialize::Bus result;
     result.set_name(bus->name);
-    for (const auto& s : bus->stops) {
-        result.add_stop(s->name);
+    for (const domain::StopId s : tcat.GetBusStops(bus->id)) {
+        result.add_stop(static_cast<string>(tcat.GetStopName(s)));
     }
-    result.set_is_circle(bus->is_circle);
-    if (bus->final_stop)
-        result.set_final_stop(bus->final_stop->name);
+    result.set_is_circle(tcat.IsCircle(bus->id));
+    if (tcat.GetFinalStop(bus->id) != domain::NO_STOP)
+        result.set_final_stop(static_cast<string>(tcat.GetStopName(tcat.GetFinalStop(bus->id))));
+    const domain::BusStats& stats = tcat.GetBusStats(bus->id);
+    serialize::BusStats& stats_result = *result.mutable_stats();
+    stats_result.set_route_length(stats.route_length);
+    stats_result.set_geo_length(stats.geo_length);
+    stats_result.set_stop_count(stats.stop_count);
+    stats_result.set_unique_stop_count(stats.unique_stop_count);
     return result;
 }
 
 
+// Names go to the base in the sorted order, so a slot keeps the position of its id there
+serialize::NameIndex Serialize(const phf::PerfectHash& name_hash, const std::vector<uint32_t>& slot_ids,
+    const std::vector<uint32_t>& sorted_ids) {
+    serialize::NameIndex result;
+    result.set_seed(name_hash.GetSeed());
+    *result.mutable_bucket_seed() = { name_hash.GetBucketSeeds().begin(), name_hash.GetBucketSeeds().end() };
+    std::vector<uint32_t> positions(slot_ids.empty() ? 0 : *max_element(slot_ids.begin(), slot_ids.end()) + 1);
+    for (uint32_t position = 0; position < sorted_ids.size(); ++position) {
+        positions[sorted_ids[position]] = position;
+    }
+    for (const uint32_t id : slot_ids) {
+        result.add_slot_id(positions[id]);
+    }
+    return result;
+}
+
 serialize::Point GetPointSerialize(const json::Array& p) {
     serialize::Point result;
     result.set_x(p[0].AsDouble());
@@ -100,6 +136,16 @@ serialize::RouterSettings GetRouterSettingSerialize(const json::Node& router_set
     serialize::RouterSettings result;
     result.set_bus_wait_time(rs_map.at("bus_wait_time"s).AsInt());
     result.set_bus_velocity(rs_map.at("bus_velocity"s).AsDouble());
+    result.set_routing_engine(rs_map.at("routing_engine"s).AsString());
+    result.set_route_cache_megabytes(rs_map.at("route_cache_megabytes"s).AsInt());
+    result.set_route_table_builder(rs_map.at("route_table_builder"s).AsString());
+    result.set_route_table_threads(rs_map.at("route_table_threads"s).AsInt());
+    result.set_collapse_parallel_edges(rs_map.at("collapse_parallel_edges"s).AsBool());
+    result.set_graph_model(rs_map.at("graph_model"s).AsString());
+    result.set_graph_build_threads(rs_map.at("graph_build_threads"s).AsInt());
+    result.set_hub_label_order(rs_map.at("hub_label_order"s).AsString());
+    result.set_astar(rs_map.at("astar"s).AsBool());
+    result.set_vertex_order(rs_map.at("vertex_order"s).AsString());
     return result;
 }
 
@@ -110,7 +156,7 @@ serialize::Graph GetGraphSerialize(const graph::DirectedWeightedGraph<double>& g
     for (size_t i = 0; i < edge_count; ++i) {
         const graph::Edge<double>& edge = g.GetEdge(i);
         serialize::Edge s_edge;
-        s_edge.set_name(edge.name);
+        s_edge.set_name_id(edge.name_id);
         s_edge.set_quality(edge.quality);
         s_edge.set_from(edge.from);
         s_edge.set_to(edge.to);
@@ -124,10 +170,91 @@ serialize::Graph GetGraphSerialize(const graph::DirectedWeightedGraph<double>& g
         }
         *result.add_vertex() = vertex;
     }
+    for (size_t i = 0; i < g.GetNameCount(); ++i) {
+        result.add_name(g.GetName(static_cast<graph::NameId>(i)));
+    }
     return result;
 }
 
 
+uint64_t GetGraphHash(const graph::DirectedWeightedGraph<double>& g) {
+    // FNV-1a over everything the route table depends on
+    uint64_t hash = 14695981039346656037ull;
+    auto mix = [&hash](uint64_t value) {
+        for (int i = 0; i < 8; ++i) {
+            hash ^= (value >> (i * 8)) & 0xff;
+            hash *= 1099511628211ull;
+        }
+    };
+    mix(g.GetVertexCount());
+    mix(g.GetEdgeCount());
+    for (size_t i = 0; i < g.GetEdgeCount(); ++i) {
+        const graph::Edge<double>& edge = g.GetEdge(i);
+        uint64_t weight_bits;
+        memcpy(&weight_bits, &edge.weight, sizeof(weight_bits));
+        mix(edge.from);
+        mix(edge.to);
+        mix(weight_bits);
+    }
+    return hash;
+}
+
+serialize::RouteTable Serialize(const graph::Router<double>& router, const graph::DirectedWeightedGraph<double>& g) {
+    serialize::RouteTable result;
+    const auto& routes = router.GetRoutesInternalData();
+    result.set_version(ROUTE_TABLE_VERSION);
+    result.set_graph_hash(GetGraphHash(g));
+    result.set_weight_scale(routes.weight_scale);
+    *result.mutable_weight() = { routes.weights.begin(), routes.weights.end() };
+    *result.mutable_prev_edge() = { routes.prev_edges.begin(), routes.prev_edges.end() };
+    return result;
+}
+
+serialize::ContractionHierarchy Serialize(const graph::ContractionRouter<double>& router,
+    const graph::DirectedWeightedGraph<double>& g) {
+    serialize::ContractionHierarchy result;
+    const auto& hierarchy = router.GetHierarchyData();
+    result.set_version(CONTRACTION_HIERARCHY_VERSION);
+    result.set_graph_hash(GetGraphHash(g));
+    *result.mutable_rank() = { hierarchy.ranks.begin(), hierarchy.ranks.end() };
+    result.mutable_shortcut_first()->Reserve(static_cast<int>(hierarchy.shortcuts.size()));
+    result.mutable_shortcut_second()->Reserve(static_cast<int>(hierarchy.shortcuts.size()));
+    for (const auto& shortcut : hierarchy.shortcuts) {
+        result.add_shortcut_first(shortcut.first);
+        result.add_shortcut_second(shortcut.second);
+    }
+    return result;
+}
+
+serialize::HubLabelSet Serialize(const graph::HubLabelRouter<double>::Labels& labels) {
+    serialize::HubLabelSet result;
+    const int entry_count = static_cast<int>(labels.entries.size());
+    result.mutable_label_size()->Reserve(static_cast<int>(labels.offsets.size()));
+    for (size_t i = 1; i < labels.offsets.size(); ++i) {
+        result.add_label_size(labels.offsets[i] - labels.offsets[i - 1]);
+    }
+    result.mutable_hub()->Reserve(entry_count);
+    result.mutable_edge()->Reserve(entry_count);
+    result.mutable_weight()->Reserve(entry_count);
+    for (const auto& entry : labels.entries) {
+        result.add_hub(entry.hub);
+        result.add_edge(entry.edge);
+        result.add_weight(entry.weight);
+    }
+    return result;
+}
+
+serialize::HubLabels Serialize(const graph::HubLabelRouter<double>& router,
+    const graph::DirectedWeightedGraph<double>& g) {
+    serialize::HubLabels result;
+    const auto& label_data = router.GetLabelData();
+    result.set_version(HUB_LABELS_VERSION);
+    result.set_graph_hash(GetGraphHash(g));
+    *result.mutable_out_labels() = Serialize(label_data.out_labels);
+    *result.mutable_in_labels() = Serialize(label_data.in_labels);
+    return result;
+}
+
 serialize::Router Serialize(const transport::Router& router) {
     serialize::Router result;
     *result.mutable_router_settings() = GetRouterSettingSerialize(router.GetSettings());
@@ -138,18 +265,51 @@ serialize::Router Serialize(const transport::Router& router) {
         si.set_id(id);
         *result.add_stop_id() = si;
     }
+    *result.mutable_vertex_component() = { router.GetVertexComponents().begin(), router.GetVertexComponents().end() };
+    *result.mutable_edge_distance() = { router.GetEdgeDistances().begin(), router.GetEdgeDistances().end() };
+    if (const graph::Router<double>* graph_router = router.GetRouter()) {
+        *result.mutable_route_table() = Serialize(*graph_router, router.GetGraph());
+    }
+    if (const graph::ContractionRouter<double>* contraction_router = router.GetContractionRouter()) {
+        *result.mutable_contraction_hierarchy() = Serialize(*contraction_router, router.GetGraph());
+    }
+    if (const graph::HubLabelRouter<double>* hub_label_router = router.GetHubLabelRouter()) {
+        *result.mutable_hub_labels() = Serialize(*hub_label_router, router.GetGraph());
+    }
     return result;
 }
 
 
 void SetStopsDistances(transport::Catalogue& tcat, const serialize::TransportCatalogue& database) {
+    size_t distance_count = 0;
+    for (size_t i = 0; i < database.stop_size(); ++i) {
+        distance_count += database.stop(i).near_stop_size();
+    }
+    tcat.ReserveDistances(distance_count);
     for (size_t i = 0; i < database.stop_size(); ++i) {
         const serialize::Stop& stop_i = database.stop(i);
-        transport::Stop* from = tcat.FindStop(stop_i.name());
+        const domain::StopId from = tcat.FindStop(stop_i.name())->id;
         for (size_t j = 0; j < stop_i.near_stop_size(); ++j) {
-            tcat.SetDistance(from, tcat.FindStop(stop_i.near_stop(j)), stop_i.distance(j));
+            tcat.SetDistance(from, tcat.FindStop(stop_i.near_stop(j))->id, stop_i.distance(j));
+        }
+    }
+}
+
+// Ids of the restored catalogue are the positions in the base. A missing or broken index is built again.
+std::optional<std::pair<phf::PerfectHash, std::vector<uint32_t>>> GetNameIndexFromDB(
+    const serialize::NameIndex& index, size_t name_count) {
+    if (name_count == 0 || index.bucket_seed_size() == 0 || index.slot_id_size() != name_count) {
+        return std::nullopt;
+    }
+    std::vector<uint32_t> slot_ids(index.slot_id().begin(), index.slot_id().end());
+    for (const uint32_t id : slot_ids) {
+        if (id >= name_count) {
+            return std::nullopt;
         }
     }
+    return std::pair{ phf::PerfectHash(index.seed(),
+        std::vector<uint32_t>(index.bucket_seed().begin(), index.bucket_seed().end()), name_count),
+        std::move(slot_ids) };
 }
 
 void AddStopFromDB(transport::Catalogue& tcat, const serialize::TransportCatalogue& database) {
@@ -157,22 +317,45 @@ void AddStopFromDB(transport::Catalogue& tcat, const serialize::TransportCatalog
         const serialize::Stop& stop_i = database.stop(i);
         tcat.AddStop(stop_i.name(), { stop_i.coordinate(0), stop_i.coordinate(1) });
     }
+    if (auto index = GetNameIndexFromDB(database.stop_index(), database.stop_size())) {
+        tcat.SetStopIndex(std::move(index->first), std::move(index->second));
+    }
+    else {
+        tcat.IndexStops();
+    }
     SetStopsDistances(tcat, database);
 }
 
 void AddBusFromDB(transport::Catalogue& tcat, const serialize::TransportCatalogue& database) {
+    bool has_stats = true;
     for (size_t i = 0; i < database.bus_size(); ++i) {
         const serialize::Bus& bus_i = database.bus(i);
-        std::vector<transport::Stop*> stops(bus_i.stop_size());
+        std::vector<domain::StopId> stops(bus_i.stop_size());
         for (size_t j = 0; j < stops.size(); ++j) {
-            stops[j] = tcat.FindStop(bus_i.stop(j));
+            stops[j] = tcat.FindStop(bus_i.stop(j))->id;
         }
-        tcat.AddBus(bus_i.name(), stops, bus_i.is_circle());
+        const domain::BusId bus = tcat.AddBus(bus_i.name(), stops, bus_i.is_circle());
         if (!bus_i.final_stop().empty()) {
-            transport::Bus* bus = tcat.FindBus(bus_i.name());
-            bus->final_stop = tcat.FindStop(bus_i.final_stop());
+            tcat.SetFinalStop(bus, tcat.FindStop(bus_i.final_stop())->id);
+        }
+        if (bus_i.has_stats()) {
+            const serialize::BusStats& stats = bus_i.stats();
+            tcat.SetBusStats(bus, { stats.route_length(), stats.geo_length(),
+                stats.stop_count(), stats.unique_stop_count() });
+        }
+        else {
+            has_stats = false;
         }
     }
+    if (auto index = GetNameIndexFromDB(database.bus_index(), database.bus_size())) {
+        tcat.SetBusIndex(std::move(index->first), std::move(index->second));
+    }
+    else {
+        tcat.IndexBuses();
+    }
+    if (!has_stats) {
+        tcat.ComputeBusStats();
+    }
 }
 
 
@@ -227,7 +410,17 @@ json::Node GetRouterSettingsFromDB(const serialize::Router& router) {
     const serialize::RouterSettings& rs = router.router_settings();
     return json::Node(json::Dict{
                     {{"bus_wait_time"s},{ rs.bus_wait_time() }},
-                    {{"bus_velocity"s},{ rs.bus_velocity() }}
+                    {{"bus_velocity"s},{ rs.bus_velocity() }},
+                    {{"routing_engine"s},{ rs.routing_engine().empty() ? "all_pairs"s : rs.routing_engine() }},
+                    {{"route_cache_megabytes"s},{ rs.route_cache_megabytes() > 0 ? rs.route_cache_megabytes() : 64 }},
+                    {{"route_table_builder"s},{ rs.route_table_builder().empty() ? "floyd_warshall"s : rs.route_table_builder() }},
+                    {{"route_table_threads"s},{ rs.route_table_threads() }},
+                    {{"collapse_parallel_edges"s},{ rs.collapse_parallel_edges() }},
+                    {{"graph_model"s},{ rs.graph_model().empty() ? "stop_pairs"s : rs.graph_model() }},
+                    {{"graph_build_threads"s},{ rs.graph_build_threads() }},
+                    {{"hub_label_order"s},{ rs.hub_label_order().empty() ? "sampled_paths"s : rs.hub_label_order() }},
+                    {{"astar"s},{ rs.astar() }},
+                    {{"vertex_order"s},{ rs.vertex_order().empty() ? "by_name"s : rs.vertex_order() }}
         });
 }
 
@@ -237,7 +430,7 @@ graph::DirectedWeightedGraph<double> GetGraphFromDB(const serialize::Router& rou
     std::vector<std::vector<graph::EdgeId>> incidence_lists(g.vertex_size());
     for (size_t i = 0; i < edges.size(); ++i) {
         const serialize::Edge& e = g.edge(i);
-        edges[i] = { e.name(), static_cast<size_t>(e.quality()),
+        edges[i] = { e.name_id(), static_cast<size_t>(e.quality()),
         static_cast<size_t>(e.from()), static_cast<size_t>(e.to()), e.weight() };
     }
     for (size_t i = 0; i < incidence_lists.size(); ++i) {
@@ -247,7 +440,8 @@ graph::DirectedWeightedGraph<double> GetGraphFromDB(const serialize::Router& rou
             incidence_lists[i].push_back(id);
         }
     }
-    return graph::DirectedWeightedGraph<double>(edges, incidence_lists);
+    std::vector<std::string> names(g.name().begin(), g.name().end());
+    return graph::DirectedWeightedGraph<double>(std::move(edges), std::move(incidence_lists), std::move(names));
 }
 
 std::map<std::string, graph::VertexId> GetStopIdsFromDB(const serialize::Router& router) {
@@ -259,8 +453,95 @@ std::map<std::string, graph::VertexId> GetStopIdsFromDB(const serialize::Router&
 }
 
 
+std::optional<graph::Router<double>::RoutesInternalData> GetRouteTableFromDB(const serialize::Router& router,
+    const graph::DirectedWeightedGraph<double>& g) {
+    if (!router.has_route_table()) {
+        return std::nullopt;
+    }
+    const serialize::RouteTable& table = router.route_table();
+    if (table.version() != ROUTE_TABLE_VERSION
+        || table.graph_hash() != GetGraphHash(g)
+        || table.weight_size() != table.prev_edge_size()) {
+        return std::nullopt;
+    }
+    graph::Router<double>::RoutesInternalData result;
+    result.vertex_count = g.GetVertexCount();
+    result.weight_scale = table.weight_scale();
+    result.weights.assign(table.weight().begin(), table.weight().end());
+    result.prev_edges.assign(table.prev_edge().begin(), table.prev_edge().end());
+    return result;
+}
+
+
+std::optional<graph::ContractionRouter<double>::HierarchyData> GetContractionHierarchyFromDB(
+    const serialize::Router& router, const graph::DirectedWeightedGraph<double>& g) {
+    if (!router.has_contraction_hierarchy()) {
+        return std::nullopt;
+    }
+    const serialize::ContractionHierarchy& hierarchy = router.contraction_hierarchy();
+    if (hierarchy.version() != CONTRACTION_HIERARCHY_VERSION
+        || hierarchy.graph_hash() != GetGraphHash(g)
+        || static_cast<size_t>(hierarchy.rank_size()) != g.GetVertexCount()
+        || hierarchy.shortcut_first_size() != hierarchy.shortcut_second_size()) {
+        return std::nullopt;
+    }
+    graph::ContractionRouter<double>::HierarchyData result;
+    result.ranks.assign(hierarchy.rank().begin(), hierarchy.rank().end());
+    result.shortcuts.reserve(hierarchy.shortcut_first_size());
+    for (int i = 0; i < hierarchy.shortcut_first_size(); ++i) {
+        result.shortcuts.push_back({ hierarchy.shortcut_first(i), hierarchy.shortcut_second(i) });
+    }
+    return result;
+}
+
+
+std::optional<graph::HubLabelRouter<double>::Labels> GetHubLabelSetFromDB(const serialize::HubLabelSet& label_set,
+    size_t vertex_count) {
+    const int entry_count = label_set.hub_size();
+    if (static_cast<size_t>(label_set.label_size_size()) != vertex_count
+        || label_set.edge_size() != entry_count || label_set.weight_size() != entry_count) {
+        return std::nullopt;
+    }
+    graph::HubLabelRouter<double>::Labels result;
+    result.offsets.reserve(vertex_count + 1);
+    result.offsets.push_back(0);
+    uint64_t offset = 0;
+    for (const uint32_t label_size : label_set.label_size()) {
+        offset += label_size;
+        if (offset > static_cast<uint64_t>(entry_count)) {
+            return std::nullopt;
+        }
+        result.offsets.push_back(static_cast<uint32_t>(offset));
+    }
+    result.entries.reserve(entry_count);
+    for (int i = 0; i < entry_count; ++i) {
+        result.entries.push_back({ label_set.hub(i), label_set.edge(i), label_set.weight(i) });
+    }
+    return result;
+}
+
+
+std::optional<graph::HubLabelRouter<double>::LabelData> GetHubLabelsFromDB(const serialize::Router& router,
+    const graph::DirectedWeightedGraph<double>& g) {
+    if (!router.has_hub_labels()) {
+        return std::nullopt;
+    }
+    const serialize::HubLabels& hub_labels = router.hub_labels();
+    if (hub_labels.version() != HUB_LABELS_VERSION || hub_labels.graph_hash() != GetGraphHash(g)) {
+        return std::nullopt;
+    }
+    auto out_labels = GetHubLabelSetFromDB(hub_labels.out_labels(), g.GetVertexCount());
+    auto in_labels = GetHubLabelSetFromDB(hub_labels.in_labels(), g.GetVertexCount());
+    if (!out_labels || !in_labels) {
+        return std::nullopt;
+    }
+    return graph::HubLabelRouter<double>::LabelData{ std::move(*out_labels), std::move(*in_labels) };
+}
+
+
 std::tuple<transport::Catalogue, renderer::MapRenderer, transport::Router,
-    graph::DirectedWeightedGraph<double>, std::map<std::string, graph::VertexId> > Deserialize(std::istream& input) {
+    graph::DirectedWeightedGraph<double>, std::map<std::string, graph::VertexId>,
+    transport::RoutingData> Deserialize(std::istream& input) {
 
     serialize::TransportCatalogue database;
     database.ParseFromIstream(&input);
@@ -272,7 +553,28 @@ std::tuple<transport::Catalogue, renderer::MapRenderer, transport::Router,
     AddStopFromDB(tcat, database);
     AddBusFromDB(tcat, database);
 
+    graph::DirectedWeightedGraph<double> g = GetGraphFromDB(database.router());
+    transport::RoutingData routing_data;
+    routing_data.routes_internal_data = GetRouteTableFromDB(database.router(), g);
+    routing_data.hierarchy_data = GetContractionHierarchyFromDB(database.router(), g);
+    routing_data.label_data = GetHubLabelsFromDB(database.router(), g);
+    routing_data.vertex_components.assign(database.router().vertex_component().begin(),
+        database.router().vertex_component().end());
+    routing_data.edge_distances.assign(database.router().edge_distance().begin(),
+        database.router().edge_distance().end());
+    for (const domain::StopId stop : tcat.GetSortedStops()) {
+        routing_data.stop_coordinates[string(tcat.GetStopName(stop))] = tcat.GetStopCoordinates(stop);
+    }
+    std::map<std::string, graph::VertexId> stop_ids = GetStopIdsFromDB(database.router());
+    routing_data.stop_vertices.assign(tcat.GetStopCount(), 0);
+    for (const auto& [name, vertex] : stop_ids) {
+        if (const domain::Stop* stop = tcat.FindStop(name)) {
+            routing_data.stop_vertices[stop->id] = vertex;
+        }
+    }
+
     return { std::move(tcat), std::move(renderer), std::move(router),
-                            GetGraphFromDB(database.router()),
-                            GetStopIdsFromDB(database.router())};
+                            std::move(g),
+                            std::move(stop_ids),
+                            std::move(routing_data)};
 }
\ No newline at end of file
@@ -3,6 +3,9 @@
 #include <fstream>
 #include <iostream>
 #include <string>
+#include <optional>
+#include <cstdint>
+#include <vector>
 
 #include "transport_catalogue.h"
 #include "map_renderer.h"
@@ -17,9 +20,12 @@ void Serialize(
     std::ostream& output
 );
 
-serialize::Stop Serialize(const transport::Stop* stop);
+serialize::Stop Serialize(const transport::Catalogue& tcat, const transport::Stop* stop);
 
-serialize::Bus Serialize(const transport::Bus* bus);
+serialize::Bus Serialize(const transport::Catalogue& tcat, const transport::Bus* bus);
+
+serialize::NameIndex Serialize(const phf::PerfectHash& name_hash, const std::vector<uint32_t>& slot_ids,
+    const std::vector<uint32_t>& sorted_ids);
 
 serialize::RenderSettings GetRenderSettingSerialize(const json::Node& render_settings);
 
@@ -27,10 +33,21 @@ serialize::RouterSettings GetRouterSettingSerialize(const json::Node& router_set
 
 serialize::Router Serialize(const transport::Router& router);
 
+serialize::RouteTable Serialize(const graph::Router<double>& router, const graph::DirectedWeightedGraph<double>& g);
+
+serialize::ContractionHierarchy Serialize(const graph::ContractionRouter<double>& router,
+    const graph::DirectedWeightedGraph<double>& g);
+
+serialize::HubLabels Serialize(const graph::HubLabelRouter<double>& router,
+    const graph::DirectedWeightedGraph<double>& g);
+
+uint64_t GetGraphHash(const graph::DirectedWeightedGraph<double>& g);
+
 
 std::tuple<
     transport::Catalogue,
     renderer::MapRenderer,
     transport::Router,
     graph::DirectedWeightedGraph<double>,
-    std::map<std::string, graph::VertexId>> Deserialize(std::istream& input);
\ No newline at end of file
+    std::map<std::string, graph::VertexId>,
+    transport::RoutingData> Deserialize(std::istream& input);
\ No newline at end of file
@@ -3,67 +3,319 @@
 #include <string>
 #include <vector>
 #include <algorithm>
+#include <utility>
 
 namespace transport {
 
     using namespace std::literals;
 
-    void Catalogue::AddStop(const std::string& name, const geo::Coordinates& coordinates) {
-        all_stops_.push_back(Stop(name, coordinates));
+    StopId Catalogue::AddStop(const std::string& name, const geo::Coordinates& coordinates) {
+        const StopId id = static_cast<StopId>(all_stops_.size());
+        all_stops_.push_back(Stop(id, name));
         Stop* added_stop = &all_stops_.back();
-        stop_to_buses_[added_stop->name];
-        stops_list_[added_stop->name] = added_stop;
+        stop_names_.push_back(added_stop->name);
+        stop_coordinates_.push_back(coordinates);
+        stop_buses_.emplace_back();
+        return id;
     }
 
-    void Catalogue::AddBus(const std::string& name, const std::vector<Stop*>& stops, bool is_circle) {
-        all_buses_.push_back(Bus(name, stops, is_circle));
+    BusId Catalogue::AddBus(const std::string& name, const std::vector<StopId>& stops, bool is_circle) {
+        const BusId id = static_cast<BusId>(all_buses_.size());
+        all_buses_.push_back(Bus(id, name));
         Bus* added_bus = &all_buses_.back();
-        for (const Stop* s : stops) {
-            stop_to_buses_[s->name][added_bus->name] = added_bus;
+        bus_names_.push_back(added_bus->name);
+        for (const StopId s : stops) {
+            std::vector<BusId>& stop_buses = stop_buses_.at(s);
+            const auto it = std::lower_bound(stop_buses.begin(), stop_buses.end(), id,
+                [this](BusId lhs, BusId rhs) { return bus_names_[lhs] < bus_names_[rhs]; });
+            if (it == stop_buses.end() || *it != id) {
+                stop_buses.insert(it, id);
+            }
         }
-        buses_list_[added_bus->name] = added_bus;
+        bus_stops_.insert(bus_stops_.end(), stops.begin(), stops.end());
+        bus_stop_offsets_.push_back(bus_stops_.size());
+        bus_is_circle_.push_back(is_circle);
+        bus_final_stops_.push_back(NO_STOP);
+        bus_stats_.emplace_back();
+        return id;
+    }
+
+    void Catalogue::SetFinalStop(BusId bus, StopId stop) {
+        bus_final_stops_.at(bus) = stop;
+    }
+
+    void Catalogue::IndexStops() {
+        sorted_stops_ = SortByName(stop_names_);
+        std::vector<std::string_view> names;
+        names.reserve(sorted_stops_.size());
+        for (const StopId stop : sorted_stops_) {
+            names.push_back(stop_names_[stop]);
+        }
+        stop_name_hash_ = phf::PerfectHash(names);
+        slot_stops_.assign(sorted_stops_.size(), NO_STOP);
+        for (const StopId stop : sorted_stops_) {
+            slot_stops_[stop_name_hash_.GetSlot(stop_names_[stop])] = stop;
+        }
+    }
+
+    void Catalogue::IndexBuses() {
+        sorted_buses_ = SortByName(bus_names_);
+        std::vector<std::string_view> names;
+        names.reserve(sorted_buses_.size());
+        for (const BusId bus : sorted_buses_) {
+            names.push_back(bus_names_[bus]);
+        }
+        bus_name_hash_ = phf::PerfectHash(names);
+        slot_buses_.assign(sorted_buses_.size(), NO_BUS);
+        for (const BusId bus : sorted_buses_) {
+            slot_buses_[bus_name_hash_.GetSlot(bus_names_[bus])] = bus;
+        }
+    }
+
+    void Catalogue::SetStopIndex(phf::PerfectHash name_hash, std::vector<StopId> slot_stops) {
+        stop_name_hash_ = std::move(name_hash);
+        slot_stops_ = std::move(slot_stops);
+        sorted_stops_ = slot_stops_;
+        std::sort(sorted_stops_.begin(), sorted_stops_.end(),
+            [this](StopId lhs, StopId rhs) { return stop_names_[lhs] < stop_names_[rhs]; });
+    }
+
+    void Catalogue::SetBusIndex(phf::PerfectHash name_hash, std::vector<BusId> slot_buses) {
+        bus_name_hash_ = std::move(name_hash);
+        slot_buses_ = std::move(slot_buses);
+        sorted_buses_ = slot_buses_;
+        std::sort(sorted_buses_.begin(), sorted_buses_.end(),
+            [this](BusId lhs, BusId rhs) { return bus_names_[lhs] < bus_names_[rhs]; });
+    }
+
+    const phf::PerfectHash& Catalogue::GetStopNameHash() const {
+        return stop_name_hash_;
+    }
+
+    const std::vector<StopId>& Catalogue::GetSlotStops() const {
+        return slot_stops_;
+    }
+
+    const phf::PerfectHash& Catalogue::GetBusNameHash() const {
+        return bus_name_hash_;
+    }
+
+    const std::vector<BusId>& Catalogue::GetSlotBuses() const {
+        return slot_buses_;
     }
 
     Stop* Catalogue::FindStop(const std::string_view stop) {
-        return stops_list_.count(stop) ? stops_list_.at(stop) : nullptr;
+        const StopId id = FindStopId(stop);
+        return id != NO_STOP ? &all_stops_[id] : nullptr;
     }
 
     const Stop* Catalogue::FindStop(const std::string_view stop) const {
-        return stops_list_.count(stop) ? stops_list_.at(stop) : nullptr;
+        const StopId id = FindStopId(stop);
+        return id != NO_STOP ? &all_stops_[id] : nullptr;
     }
 
     Bus* Catalogue::FindBus(const std::string_view bus_name) {
-        return buses_list_.count(bus_name) ? buses_list_.at(bus_name) : nullptr;
+        const BusId id = FindBusId(bus_name);
+        return id != NO_BUS ? &all_buses_[id] : nullptr;
     }
 
     const Bus* Catalogue::FindBus(const std::string_view bus_name) const {
-        return buses_list_.count(bus_name) ? buses_list_.at(bus_name) : nullptr;
+        const BusId id = FindBusId(bus_name);
+        return id != NO_BUS ? &all_buses_[id] : nullptr;
+    }
+
+    size_t Catalogue::GetStopCount() const {
+        return all_stops_.size();
+    }
+
+    size_t Catalogue::GetBusCount() const {
+        return all_buses_.size();
+    }
+
+    const Stop& Catalogue::GetStop(StopId stop) const {
+        return all_stops_.at(stop);
+    }
+
+    const Bus& Catalogue::GetBus(BusId bus) const {
+        return all_buses_.at(bus);
+    }
+
+    std::string_view Catalogue::GetStopName(StopId stop) const {
+        return stop_names_[stop];
+    }
+
+    const geo::Coordinates& Catalogue::GetStopCoordinates(StopId stop) const {
+        return stop_coordinates_[stop];
+    }
+
+    std::string_view Catalogue::GetBusName(BusId bus) const {
+        return bus_names_[bus];
+    }
+
+    Catalogue::StopIdRange Catalogue::GetBusStops(BusId bus) const {
+        const StopId* stops = bus_stops_.data();
+        return { stops + bus_stop_offsets_[bus], stops + bus_stop_offsets_[bus + 1] };
+    }
+
+    bool Catalogue::IsCircle(BusId bus) const {
+        return bus_is_circle_[bus];
+    }
+
+    StopId Catalogue::GetFinalStop(BusId bus) const {
+        return bus_final_stops_[bus];
     }
 
-    std::map<std::string_view, Bus*> Catalogue::GetBusesOnStop(const std::string_view stop_name) {
-        return stop_to_buses_.at(stop_name);
+    void Catalogue::ComputeBusStats() {
+        for (BusId bus = 0; bus < bus_stats_.size(); ++bus) {
+            bus_stats_[bus] = CalculateBusStats(bus);
+        }
     }
 
-    const std::map<std::string_view, Bus*> Catalogue::GetBusesOnStop(const std::string_view stop_name) const {
-        return stop_to_buses_.at(stop_name);
+    void Catalogue::SetBusStats(BusId bus, const BusStats& stats) {
+        bus_stats_.at(bus) = stats;
     }
 
-    void Catalogue::SetDistance(Stop* from, Stop* to, int dist) {
-        from->stop_distances[to->name] = dist;
+    const BusStats& Catalogue::GetBusStats(BusId bus) const {
+        return bus_stats_[bus];
     }
 
-    int Catalogue::GetDistance(const Stop* from, const Stop* to) const {
-        if (from->stop_distances.count(to->name)) return from->stop_distances.at(to->name);
-        else if (to->stop_distances.count(from->name)) return to->stop_distances.at(from->name);
-        else return 0;
+    Catalogue::BusIdRange Catalogue::GetBusesOnStop(StopId stop) const {
+        const std::vector<BusId>& buses = stop_buses_[stop];
+        return { buses.data(), buses.data() + buses.size() };
     }
 
-    const std::map<std::string_view, Bus*>& Catalogue::GetSortedAllBuses() const {
-        return buses_list_;
+    void Catalogue::ReserveDistances(size_t count) {
+        road_distances_.reserve(count);
+        // At most half of the slots are taken
+        size_t slot_count = 16;
+        while (slot_count < count * 2) {
+            slot_count *= 2;
+        }
+        if (slot_count > distance_slots_.size()) {
+            RehashDistances(slot_count);
+        }
     }
 
-    const std::map<std::string_view, Stop*>& Catalogue::GetSortedAllStops() const {
-        return stops_list_;
+    void Catalogue::SetDistance(StopId from, StopId to, int dist) {
+        if ((road_distances_.size() + 1) * 2 > distance_slots_.size()) {
+            RehashDistances(std::max<size_t>(16, distance_slots_.size() * 2));
+        }
+        const size_t slot = FindDistanceSlot(from, to);
+        if (distance_slots_[slot] == EMPTY_SLOT) {
+            distance_slots_[slot] = static_cast<uint32_t>(road_distances_.size());
+            road_distances_.push_back({ from, to, dist });
+        }
+        else {
+            road_distances_[distance_slots_[slot]].distance = dist;
+        }
+        for (const BusId bus : stop_buses_[from]) {
+            bus_stats_[bus].route_length = CalculateRouteLength(bus);
+        }
+    }
+
+    int Catalogue::GetDistance(StopId from, StopId to) const {
+        if (distance_slots_.empty()) {
+            return 0;
+        }
+        if (const uint32_t index = distance_slots_[FindDistanceSlot(from, to)]; index != EMPTY_SLOT) {
+            return road_distances_[index].distance;
+        }
+        if (const uint32_t index = distance_slots_[FindDistanceSlot(to, from)]; index != EMPTY_SLOT) {
+            return road_distances_[index].distance;
+        }
+        return 0;
+    }
+
+    const std::vector<RoadDistance>& Catalogue::GetRoadDistances() const {
+        return road_distances_;
+    }
+
+    // The slot of the pair, or the empty slot where it would go
+    size_t Catalogue::FindDistanceSlot(StopId from, StopId to) const {
+        const uint64_t key = (static_cast<uint64_t>(from) << 32) | to;
+        const size_t mask = distance_slots_.size() - 1;
+        size_t slot = static_cast<size_t>((key * 0x9E3779B97F4A7C15ull) >> 32) & mask;
+        while (distance_slots_[slot] != EMPTY_SLOT) {
+            const RoadDistance& entry = road_distances_[distance_slots_[slot]];
+            if (entry.from == from && entry.to == to) {
+                break;
+            }
+            slot = (slot + 1) & mask;
+        }
+        return slot;
+    }
+
+    void Catalogue::RehashDistances(size_t slot_count) {
+        distance_slots_.assign(slot_count, EMPTY_SLOT);
+        for (uint32_t index = 0; index < road_distances_.size(); ++index) {
+            distance_slots_[FindDistanceSlot(road_distances_[index].from, road_distances_[index].to)] = index;
+        }
+    }
+
+    BusStats Catalogue::CalculateBusStats(BusId bus) const {
+        const StopIdRange stops = GetBusStops(bus);
+        std::vector<StopId> unique_stops(stops.begin(), stops.end());
+        BusStats stats;
+        stats.route_length = CalculateRouteLength(bus);
+        stats.stop_count = static_cast<int>(unique_stops.size());
+        for (const StopId* it = stops.begin(); it != stops.end() && it + 1 != stops.end(); ++it) {
+            stats.geo_length += geo::ComputeDistance(stop_coordinates_[*it], stop_coordinates_[*(it + 1)]);
+        }
+        std::sort(unique_stops.begin(), unique_stops.end());
+        stats.unique_stop_count = static_cast<int>(
+            std::unique(unique_stops.begin(), unique_stops.end()) - unique_stops.begin());
+        return stats;
+    }
+
+    int Catalogue::CalculateRouteLength(BusId bus) const {
+        const StopIdRange stops = GetBusStops(bus);
+        int route_length = 0;
+        for (const StopId* it = stops.begin(); it != stops.end() && it + 1 != stops.end(); ++it) {
+            route_length += GetDistance(*it, *(it + 1));
+        }
+        return route_length;
+    }
+
+    const std::vector<BusId>& Catalogue::GetSortedBuses() const {
+        return sorted_buses_;
+    }
+
+    const std::vector<StopId>& Catalogue::GetSortedStops() const {
+        return sorted_stops_;
+    }
+
+    StopId Catalogue::FindStopId(std::string_view name) const {
+        if (slot_stops_.empty()) {
+            return NO_STOP;
+        }
+        const StopId id = slot_stops_[stop_name_hash_.GetSlot(name)];
+        return stop_names_[id] == name ? id : NO_STOP;
+    }
+
+    BusId Catalogue::FindBusId(std::string_view name) const {
+        if (slot_buses_.empty()) {
+            return NO_BUS;
+        }
+        const BusId id = slot_buses_[bus_name_hash_.GetSlot(name)];
+        return bus_names_[id] == name ? id : NO_BUS;
+    }
+
+    // Ids sorted by names, only the last id is left of equal names
+    std::vector<uint32_t> Catalogue::SortByName(const std::vector<std::string_view>& names) {
+        std::vector<uint32_t> ids(names.size());
+        for (uint32_t id = 0; id < ids.size(); ++id) {
+            ids[id] = id;
+        }
+        std::stable_sort(ids.begin(), ids.end(),
+            [&names](uint32_t lhs, uint32_t rhs) { return names[lhs] < names[rhs]; });
+        std::vector<uint32_t> result;
+        result.reserve(ids.size());
+        for (size_t i = 0; i < ids.size(); ++i) {
+            if (i + 1 == ids.size() || names[ids[i]] != names[ids[i + 1]]) {
+                result.push_back(ids[i]);
+            }
+        }
+        return result;
     }
 
 } // namespace transport
\ No newline at end of file
@@ -2,13 +2,15 @@
 
 #include "geo.h"
 #include "domain.h"
+#include "perfect_hash.h"
+#include "ranges.h"
 
+#include <cstdint>
 #include <deque>
+#include <limits>
 #include <vector>
 #include <string>
-#include <unordered_map>
 #include <string_view>
-#include <map>
 
 namespace transport {
 
@@ -16,9 +18,33 @@ namespace transport {
 
     class Catalogue {
     public:
-        void AddStop(const std::string& name, const geo::Coordinates& coordinates);
+        using StopIdRange = ranges::Range<const StopId*>;
+        using BusIdRange = ranges::Range<const BusId*>;
 
-        void AddBus(const std::string& num, const std::vector<Stop*>& stops, bool is_circle);
+        StopId AddStop(const std::string& name, const geo::Coordinates& coordinates);
+
+        BusId AddBus(const std::string& num, const std::vector<StopId>& stops, bool is_circle);
+
+        void SetFinalStop(BusId bus, StopId stop);
+
+        // Names are found once they are indexed, so these go after the last stop or bus is added.
+        // Of stops with the same name the last one is found.
+        void IndexStops();
+
+        void IndexBuses();
+
+        // Restores an index built by IndexStops: the hash over the names and the stop of every slot
+        void SetStopIndex(phf::PerfectHash name_hash, std::vector<StopId> slot_stops);
+
+        void SetBusIndex(phf::PerfectHash name_hash, std::vector<BusId> slot_buses);
+
+        const phf::PerfectHash& GetStopNameHash() const;
+
+        const std::vector<StopId>& GetSlotStops() const;
+
+        const phf::PerfectHash& GetBusNameHash() const;
+
+        const std::vector<BusId>& GetSlotBuses() const;
 
         Stop* FindStop(const std::string_view stop);
 
@@ -28,24 +54,93 @@ namespace transport {
 
         const Bus* FindBus(const std::string_view bus_num) const;
 
-        std::map<std::string_view, Bus*> GetBusesOnStop(const std::string_view stop_name);
+        size_t GetStopCount() const;
+
+        size_t GetBusCount() const;
+
+        const Stop& GetStop(StopId stop) const;
+
+        const Bus& GetBus(BusId bus) const;
+
+        std::string_view GetStopName(StopId stop) const;
+
+        const geo::Coordinates& GetStopCoordinates(StopId stop) const;
+
+        std::string_view GetBusName(BusId bus) const;
+
+        // A non-circle bus lists its stops there and back
+        StopIdRange GetBusStops(BusId bus) const;
+
+        bool IsCircle(BusId bus) const;
+
+        // NO_STOP if it isn't set
+        StopId GetFinalStop(BusId bus) const;
+
+        // Stats of every bus, once the routes and road distances are set
+        void ComputeBusStats();
+
+        void SetBusStats(BusId bus, const BusStats& stats);
+
+        const BusStats& GetBusStats(BusId bus) const;
+
+        // Buses through the stop in the order of their names
+        BusIdRange GetBusesOnStop(StopId stop) const;
+
+        // Space for the given number of distances, so that filling the index doesn't rehash it
+        void ReserveDistances(size_t count);
 
-        const std::map<std::string_view, Bus*> GetBusesOnStop(const std::string_view stop_name) const;
+        // Route lengths of the buses through from are updated
+        void SetDistance(StopId from, StopId to, int dist);
 
-        void SetDistance(Stop* from, Stop* to, int dist);
+        // The distance set for from -> to, otherwise the one for to -> from, otherwise 0
+        int GetDistance(StopId from, StopId to) const;
 
-        int GetDistance(const Stop* from, const Stop* to) const;
+        // In the order the pairs were first set
+        const std::vector<RoadDistance>& GetRoadDistances() const;
 
-        const std::map <std::string_view, Bus*>& GetSortedAllBuses() const;
+        // Indexed ids in the order of names
+        const std::vector<BusId>& GetSortedBuses() const;
 
-        const std::map <std::string_view, Stop*>& GetSortedAllStops() const;
+        const std::vector<StopId>& GetSortedStops() const;
 
     private:
         std::deque<Stop> all_stops_;
         std::deque<Bus> all_buses_;
-        std::unordered_map < std::string_view, std::map<std::string_view, Bus*>> stop_to_buses_;
-        std::map < std::string_view, Stop* > stops_list_;
-        std::map < std::string_view, Bus* > buses_list_;
+        phf::PerfectHash stop_name_hash_;
+        std::vector<StopId> slot_stops_;
+        std::vector<StopId> sorted_stops_;
+        phf::PerfectHash bus_name_hash_;
+        std::vector<BusId> slot_buses_;
+        std::vector<BusId> sorted_buses_;
+
+        // Arrays by id, names point into all_stops_ and all_buses_
+        std::vector<std::string_view> stop_names_;
+        std::vector<geo::Coordinates> stop_coordinates_;
+        std::vector<std::string_view> bus_names_;
+        // Stops of a bus are bus_stops_[bus_stop_offsets_[bus], bus_stop_offsets_[bus + 1])
+        std::vector<StopId> bus_stops_;
+        std::vector<size_t> bus_stop_offsets_ = { 0 };
+        std::vector<bool> bus_is_circle_;
+        std::vector<StopId> bus_final_stops_;
+        std::vector<BusStats> bus_stats_;
+        // Kept sorted by bus names as buses are added
+        std::vector<std::vector<BusId>> stop_buses_;
+
+        // Open addressing over the packed (from, to) key, a slot keeps an index into road_distances_
+        static constexpr uint32_t EMPTY_SLOT = std::numeric_limits<uint32_t>::max();
+        std::vector<RoadDistance> road_distances_;
+        std::vector<uint32_t> distance_slots_;
+
+        size_t FindDistanceSlot(StopId from, StopId to) const;
+        void RehashDistances(size_t slot_count);
+
+        // NO_STOP and NO_BUS for unknown names
+        StopId FindStopId(std::string_view name) const;
+        BusId FindBusId(std::string_view name) const;
+        static std::vector<uint32_t> SortByName(const std::vector<std::string_view>& names);
+
+        BusStats CalculateBusStats(BusId bus) const;
+        int CalculateRouteLength(BusId bus) const;
     };
     
 } // namespace transport
\ No newline at end of file
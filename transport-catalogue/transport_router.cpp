@@ -3,9 +3,15 @@
 #include <string>
 #include <string_view>
 #include <map>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 #include <algorithm>
+#include <cmath>
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+#include <thread>
 
 using namespace std;
 
@@ -28,80 +34,332 @@ namespace transport {
             , stop_ids_(stop_ids) {
         if (settings_node.IsNull()) return;
         SetSettings(settings_node);
-        router_ptr_ = new graph::Router<double>(graph_);
+        BuildRouter();
     }
 
     void Router::SetGraph(graph::DirectedWeightedGraph<double>&& graph,
-        std::map<std::string, graph::VertexId>&& stop_ids) {
+        std::map<std::string, graph::VertexId>&& stop_ids,
+        RoutingData&& routing_data) {
         graph_ = move(graph);
         stop_ids_ = move(stop_ids);
-        router_ptr_ = new graph::Router<double>(graph_);
+        stop_vertices_ = move(routing_data.stop_vertices);
+        BuildRouter(move(routing_data));
     }
 
     const graph::DirectedWeightedGraph<double>& Router::BuildGraph(const Catalogue& tcat) {
-        const map<string_view, Stop*>& all_stops = tcat.GetSortedAllStops();
-        const map<string_view, Bus*>& all_buses = tcat.GetSortedAllBuses();
-        graph::DirectedWeightedGraph<double> stops_graph(all_stops.size() * 2);
         map<std::string, graph::VertexId> stop_ids;
+        RoutingData routing_data;
         graph::VertexId vertex_id = 0;
-        for (const auto& [stop_name, stop_ptr] : all_stops) {
-            stop_ids[stop_ptr->name] = vertex_id;
-            stops_graph.AddEdge({ stop_ptr->name,
+        stop_vertices_.assign(tcat.GetStopCount(), 0);
+        for (const StopId stop : GetStopOrder(tcat)) {
+            const string stop_name(tcat.GetStopName(stop));
+            stop_ids[stop_name] = vertex_id;
+            stop_vertices_[stop] = vertex_id;
+            routing_data.stop_coordinates[stop_name] = tcat.GetStopCoordinates(stop);
+            vertex_id += 2;
+        }
+        stop_ids_ = move(stop_ids);
+
+        graph_ = BuildDistanceGraph(tcat);
+        routing_data.edge_distances.reserve(graph_.GetEdgeCount());
+        for (graph::EdgeId edge_id = 0; edge_id < graph_.GetEdgeCount(); ++edge_id) {
+            routing_data.edge_distances.push_back(graph_.GetEdge(edge_id).weight);
+        }
+        BuildRouter(move(routing_data));
+        return graph_;
+    }
+
+    // Edges get road distances in meters as weights, BuildRouter turns them into minutes.
+    // The same catalogue always gives the same edge ids.
+    graph::DirectedWeightedGraph<double> Router::BuildDistanceGraph(const Catalogue& tcat) {
+        // Buses go in the order of names, routes are walked by stop ids
+        const vector<BusId>& buses = tcat.GetSortedBuses();
+        size_t vertex_count = stop_ids_.size() * 2;
+        if (graph_model_ == GraphModel::LINEAR) {
+            for (const BusId bus : buses) {
+                for (const auto& [first, last] : GetRideSegments(tcat, bus)) {
+                    vertex_count += last - first + 1;
+                }
+            }
+        }
+        graph::DirectedWeightedGraph<double> stops_graph(vertex_count);
+        vector<const std::string*> stop_names(stop_ids_.size());
+        for (const auto& [name, vertex] : stop_ids_) {
+            stop_names.at(vertex / 2) = &name;
+        }
+        if (stop_vertices_.size() != tcat.GetStopCount()) {
+            stop_vertices_.assign(tcat.GetStopCount(), 0);
+            for (const auto& [name, vertex] : stop_ids_) {
+                stop_vertices_[tcat.FindStop(name)->id] = vertex;
+            }
+        }
+        for (graph::VertexId vertex_id = 0; vertex_id < stop_names.size() * 2; vertex_id += 2) {
+            stops_graph.AddEdge({ stops_graph.AddName(*stop_names[vertex_id / 2]),
                                   0,
                                   vertex_id,
-                                  ++vertex_id,
-                                  static_cast<double>(bus_wait_time_) });
-            ++vertex_id;
+                                  vertex_id + 1,
+                                  0.0 });
+        }
+
+        if (graph_model_ == GraphModel::LINEAR) {
+            AddBusChains(stops_graph, tcat, buses);
+        }
+        else {
+            AddStopPairRides(stops_graph, tcat, buses);
+        }
+        return vertex_order_ == VertexOrder::HILBERT ? SortEdgesByTail(stops_graph) : stops_graph;
+    }
+
+    std::vector<StopId> Router::GetStopOrder(const Catalogue& tcat) const {
+        vector<StopId> stops = tcat.GetSortedStops();
+        if (vertex_order_ == VertexOrder::BY_NAME || stops.empty()) {
+            return stops;
         }
-        stop_ids_ = move(stop_ids);
 
-        for_each(
-            all_buses.begin(),
-            all_buses.end(),
-            [&stops_graph, this](const auto& item)
-            {
-                const auto& bus_ptr = item.second;
-                const std::vector<Stop*>& stops = bus_ptr->stops;
-                size_t stops_count = stops.size();
-                for (size_t i = 0; i < stops_count; ++i) {
-                    for (size_t j = i + 1; j < stops_count; ++j) {
-                        const Stop* stop_from = stops[i];
-                        const Stop* stop_to = stops[j];
-                        int dist_sum = 0;
-                        for (size_t k = i + 1; k <= j; ++k) {
-                            dist_sum += stops[k - 1]->GetDistance(stops[k]);
-                        }
-                        const double k = 100.0 / 6.0;
-                        stops_graph.AddEdge({ bus_ptr->name,
-                                              j - i,
-                                              stop_ids_.at(stop_from->name) + 1,
-                                              stop_ids_.at(stop_to->name),
-                                              static_cast<double>(dist_sum) / (bus_velocity_ * k) });
-                        if (!bus_ptr->is_circle && stop_to == bus_ptr->final_stop && j == stops_count / 2) break;
+        // Coordinates go to a 2^16 x 2^16 grid over the bounding box, one scale for both axes
+        constexpr uint32_t GRID_SIZE = 1 << 16;
+        double min_lat = tcat.GetStopCoordinates(stops.front()).lat;
+        double max_lat = min_lat;
+        double min_lng = tcat.GetStopCoordinates(stops.front()).lng;
+        double max_lng = min_lng;
+        for (const StopId stop : stops) {
+            const geo::Coordinates& coordinates = tcat.GetStopCoordinates(stop);
+            min_lat = min(min_lat, coordinates.lat);
+            max_lat = max(max_lat, coordinates.lat);
+            min_lng = min(min_lng, coordinates.lng);
+            max_lng = max(max_lng, coordinates.lng);
+        }
+        const double span = max(max_lat - min_lat, max_lng - min_lng);
+        const double scale = span > 0.0 ? (GRID_SIZE - 1) / span : 0.0;
+        auto get_hilbert_index = [&](const geo::Coordinates& coordinates) {
+            uint32_t x = static_cast<uint32_t>((coordinates.lng - min_lng) * scale);
+            uint32_t y = static_cast<uint32_t>((coordinates.lat - min_lat) * scale);
+            uint64_t index = 0;
+            for (uint32_t side = GRID_SIZE / 2; side > 0; side /= 2) {
+                const uint32_t rx = (x & side) > 0 ? 1 : 0;
+                const uint32_t ry = (y & side) > 0 ? 1 : 0;
+                index += static_cast<uint64_t>(side) * side * ((3 * rx) ^ ry);
+                // Turns the quadrant so that the curve inside it starts and ends at the right corners
+                if (ry == 0) {
+                    if (rx == 1) {
+                        x = GRID_SIZE - 1 - x;
+                        y = GRID_SIZE - 1 - y;
                     }
+                    swap(x, y);
                 }
-            });
+            }
+            return index;
+        };
+        vector<pair<uint64_t, StopId>> keyed_stops;
+        keyed_stops.reserve(stops.size());
+        for (const StopId stop : stops) {
+            keyed_stops.emplace_back(get_hilbert_index(tcat.GetStopCoordinates(stop)), stop);
+        }
+        // Stable, so stops in one grid cell keep the order of names
+        stable_sort(keyed_stops.begin(), keyed_stops.end(), [](const auto& lhs, const auto& rhs) {
+            return lhs.first < rhs.first;
+        });
+        for (size_t i = 0; i < stops.size(); ++i) {
+            stops[i] = keyed_stops[i].second;
+        }
+        return stops;
+    }
 
-        graph_ = move(stops_graph);
-        router_ptr_ = new graph::Router<double>(graph_);
-        return graph_;
+    // Edge ids follow the vertices, so the edges of a vertex are stored together. Incidence lists
+    // keep their order, so searches and tables see the same graph up to the edge ids.
+    graph::DirectedWeightedGraph<double> Router::SortEdgesByTail(const graph::DirectedWeightedGraph<double>& graph) {
+        vector<graph::Edge<double>> edges;
+        edges.reserve(graph.GetEdgeCount());
+        vector<vector<graph::EdgeId>> incidence_lists(graph.GetVertexCount());
+        for (graph::VertexId vertex = 0; vertex < incidence_lists.size(); ++vertex) {
+            for (const graph::EdgeId edge_id : graph.GetIncidentEdges(vertex)) {
+                incidence_lists[vertex].push_back(edges.size());
+                edges.push_back(graph.GetEdge(edge_id));
+            }
+        }
+        vector<string> names;
+        names.reserve(graph.GetNameCount());
+        for (size_t i = 0; i < graph.GetNameCount(); ++i) {
+            names.emplace_back(graph.GetName(static_cast<graph::NameId>(i)));
+        }
+        return graph::DirectedWeightedGraph<double>(move(edges), move(incidence_lists), move(names));
+    }
+
+    void Router::AddStopPairRides(graph::DirectedWeightedGraph<double>& stops_graph, const Catalogue& tcat,
+        const std::vector<BusId>& buses) {
+        // In collapse mode only the shortest ride between two stops is kept, the first one on ties.
+        // Its edge still carries the bus name and span count, so route items don't change.
+        vector<graph::Edge<double>> ride_edges;
+        unordered_map<size_t, size_t> ride_edge_index;
+        const size_t vertex_count = stops_graph.GetVertexCount();
+        auto add_ride_edge = [&](graph::Edge<double>&& edge) {
+            if (!collapse_parallel_edges_) {
+                stops_graph.AddEdge(move(edge));
+                return;
+            }
+            const auto [it, inserted] = ride_edge_index.emplace(edge.from * vertex_count + edge.to, ride_edges.size());
+            if (inserted) {
+                ride_edges.push_back(move(edge));
+            }
+            else if (edge.weight < ride_edges[it->second].weight) {
+                ride_edges[it->second] = move(edge);
+            }
+        };
+
+        // Buses are independent: each one gets its own edge buffer filled on a pool of threads,
+        // the buffers are merged in bus order, so the graph doesn't depend on the number of threads
+        vector<graph::NameId> bus_name_ids;
+        bus_name_ids.reserve(buses.size());
+        for (const BusId bus : buses) {
+            bus_name_ids.push_back(stops_graph.AddName(string(tcat.GetBusName(bus))));
+        }
+        vector<vector<graph::Edge<double>>> bus_edges(buses.size());
+        size_t thread_count = graph_build_threads_ > 0
+            ? static_cast<size_t>(graph_build_threads_) : max<size_t>(thread::hardware_concurrency(), 1);
+        thread_count = min(thread_count, max<size_t>(buses.size(), 1));
+        atomic<size_t> next_bus{ 0 };
+        auto worker = [&]() {
+            for (size_t i = next_bus++; i < buses.size(); i = next_bus++) {
+                bus_edges[i] = GetStopPairRides(tcat, buses[i], bus_name_ids[i]);
+            }
+        };
+        vector<thread> threads;
+        threads.reserve(thread_count - 1);
+        for (size_t i = 1; i < thread_count; ++i) {
+            threads.emplace_back(worker);
+        }
+        worker();
+        for (thread& t : threads) {
+            t.join();
+        }
+
+        for (vector<graph::Edge<double>>& edges : bus_edges) {
+            for (graph::Edge<double>& edge : edges) {
+                add_ride_edge(move(edge));
+            }
+            vector<graph::Edge<double>>().swap(edges);
+        }
+        for (graph::Edge<double>& edge : ride_edges) {
+            stops_graph.AddEdge(move(edge));
+        }
+    }
+
+
+    std::vector<graph::Edge<double>> Router::GetStopPairRides(const Catalogue& tcat, BusId bus,
+        graph::NameId bus_name_id) const {
+        const Catalogue::StopIdRange stops = tcat.GetBusStops(bus);
+        const size_t stops_count = stops.end() - stops.begin();
+        const StopId* stop_ids = stops.begin();
+        const bool is_circle = tcat.IsCircle(bus);
+        const StopId final_stop = tcat.GetFinalStop(bus);
+        // Road distance from the first stop, a ride i -> j is prefix[j] - prefix[i] long
+        vector<int> prefix(stops_count, 0);
+        vector<graph::VertexId> vertices(stops_count);
+        for (size_t i = 0; i < stops_count; ++i) {
+            vertices[i] = stop_vertices_[stop_ids[i]];
+            if (i > 0) {
+                prefix[i] = prefix[i - 1] + tcat.GetDistance(stop_ids[i - 1], stop_ids[i]);
+            }
+        }
+        vector<graph::Edge<double>> edges;
+        edges.reserve(stops_count * (stops_count - (stops_count > 0)) / 2);
+        for (size_t i = 0; i < stops_count; ++i) {
+            for (size_t j = i + 1; j < stops_count; ++j) {
+                edges.push_back({ bus_name_id,
+                                  j - i,
+                                  vertices[i] + 1,
+                                  vertices[j],
+                                  static_cast<double>(prefix[j] - prefix[i]) });
+                if (!is_circle && stop_ids[j] == final_stop && j == stops_count / 2) break;
+            }
+        }
+        return edges;
+    }
+
+    // Every ride segment of a bus gets a chain of on-board vertices, one per stop:
+    // boarding edges lead from the stop into the chain, alighting edges lead back,
+    // ride edges move one stop along the chain. A bus with n stops adds O(n) edges.
+    void Router::AddBusChains(graph::DirectedWeightedGraph<double>& stops_graph, const Catalogue& tcat,
+        const std::vector<BusId>& buses) {
+        graph::VertexId on_board_vertex = stop_ids_.size() * 2;
+        for (const BusId bus : buses) {
+            const StopId* stops = tcat.GetBusStops(bus).begin();
+            const graph::NameId bus_name_id = stops_graph.AddName(string(tcat.GetBusName(bus)));
+            for (const auto& [first, last] : GetRideSegments(tcat, bus)) {
+                for (size_t i = first; i <= last; ++i) {
+                    const graph::VertexId stop_vertex = stop_vertices_[stops[i]];
+                    if (i > first) {
+                        stops_graph.AddEdge({ bus_name_id, 0, on_board_vertex, stop_vertex, 0.0 });
+                    }
+                    if (i < last) {
+                        stops_graph.AddEdge({ bus_name_id, 0, stop_vertex + 1, on_board_vertex, 0.0 });
+                        stops_graph.AddEdge({ bus_name_id,
+                                              1,
+                                              on_board_vertex,
+                                              on_board_vertex + 1,
+                                              static_cast<double>(tcat.GetDistance(stops[i], stops[i + 1])) });
+                    }
+                    ++on_board_vertex;
+                }
+            }
+        }
+    }
+
+    std::vector<std::pair<size_t, size_t>> Router::GetRideSegments(const Catalogue& tcat, BusId bus) {
+        const Catalogue::StopIdRange stops = tcat.GetBusStops(bus);
+        const size_t stops_count = stops.end() - stops.begin();
+        if (stops_count < 2) {
+            return {};
+        }
+        // A non-roundtrip bus can't be ridden through its final stop
+        const size_t middle = stops_count / 2;
+        if (!tcat.IsCircle(bus) && stops.begin()[middle] == tcat.GetFinalStop(bus)) {
+            return { { 0, middle }, { middle, stops_count - 1 } };
+        }
+        return { { 0, stops_count - 1 } };
     }
 
-    json::Array Router::GetEdgesItems(const std::vector<graph::EdgeId>& edges) const {
+    json::Array Router::GetEdgesItems(const std::vector<graph::EdgeId>& edges,
+        const RouteParameters& parameters) const {
+        const Customization* customization = GetCustomization(parameters);
+        const graph::DirectedWeightedGraph<double>& weighted_graph = customization ? customization->graph : graph_;
         json::Array items_array;
         items_array.reserve(edges.size());
+        // Vertices past the stop ones belong to on-board chains of the linear model:
+        // a ride there is gathered from boarding to alighting
+        const graph::VertexId stop_vertex_count = stop_ids_.size() * 2;
+        std::string_view ride_bus;
+        int ride_span_count = 0;
+        double ride_time = 0.0;
         for (auto& edge_id : edges) {
-            const graph::Edge<double>& edge = graph_.GetEdge(edge_id);
-            if (edge.quality == 0) {
+            const graph::Edge<double>& edge = weighted_graph.GetEdge(edge_id);
+            if (edge.from >= stop_vertex_count || edge.to >= stop_vertex_count) {
+                if (edge.from < stop_vertex_count) {
+                    ride_bus = graph_.GetName(edge.name_id);
+                    ride_span_count = 0;
+                    ride_time = 0.0;
+                }
+                ride_span_count += static_cast<int>(edge.quality);
+                ride_time += edge.weight;
+                if (edge.to < stop_vertex_count) {
+                    items_array.emplace_back(json::Node(json::Dict{
+                        {{"bus"s},{static_cast<string>(ride_bus)}},
+                        {{"span_count"s},{ride_span_count}},
+                        {{"time"s},{ride_time}},
+                        {{"type"s},{"Bus"s}}
+                        }));
+                }
+            }
+            else if (edge.quality == 0) {
                 items_array.emplace_back(json::Node(json::Dict{
-                    {{"stop_name"s},{static_cast<string>(edge.name)}},
+                    {{"stop_name"s},{graph_.GetName(edge.name_id)}},
                     {{"time"s},{edge.weight}},
                     {{"type"s},{"Wait"s}}
                     }));
             }
             else {
                 items_array.emplace_back(json::Node(json::Dict{
-                    {{"bus"s},{static_cast<string>(edge.name)}},
+                    {{"bus"s},{graph_.GetName(edge.name_id)}},
                     {{"span_count"s},{static_cast<int>(edge.quality)}},
                     {{"time"s},{edge.weight}},
                     {{"type"s},{"Bus"s}}
@@ -111,8 +369,123 @@ namespace transport {
         return items_array;
     }
 
-    std::optional<graph::Router<double>::RouteInfo> Router::GetRouteInfo(const Stop* from, const Stop* to) const {
-        return router_ptr_->BuildRoute(stop_ids_.at(from->name), stop_ids_.at(to->name));
+    std::optional<graph::Router<double>::RouteInfo> Router::GetRouteInfo(const Stop* from, const Stop* to,
+        const RouteParameters& parameters) const {
+        const graph::VertexId vertex_from = GetStopVertex(from);
+        const graph::VertexId vertex_to = GetStopVertex(to);
+        if (vertex_components_[vertex_from] != vertex_components_[vertex_to]) {
+            return nullopt;
+        }
+        if (const Customization* customization = GetCustomization(parameters)) {
+            return customization->router->BuildRoute(vertex_from, vertex_to);
+        }
+        return router_ptr_->BuildRoute(vertex_from, vertex_to);
+    }
+
+    std::vector<std::optional<double>> Router::GetRouteTimes(const std::vector<const Stop*>& from,
+        const std::vector<const Stop*>& to) const {
+        // The engine gets the known stops of one component at a time, so the searches don't look
+        // for targets they can't reach. Cells are spread back over the full matrix.
+        struct ComponentStops {
+            vector<graph::VertexId> sources;
+            vector<size_t> rows;
+            vector<graph::VertexId> targets;
+            vector<size_t> columns;
+        };
+        unordered_map<graph::ComponentId, ComponentStops> components;
+        for (size_t row = 0; row < from.size(); ++row) {
+            if (from[row]) {
+                const graph::VertexId vertex = GetStopVertex(from[row]);
+                ComponentStops& component = components[vertex_components_[vertex]];
+                component.sources.push_back(vertex);
+                component.rows.push_back(row);
+            }
+        }
+        for (size_t column = 0; column < to.size(); ++column) {
+            if (to[column]) {
+                const graph::VertexId vertex = GetStopVertex(to[column]);
+                const auto it = components.find(vertex_components_[vertex]);
+                if (it != components.end()) {
+                    it->second.targets.push_back(vertex);
+                    it->second.columns.push_back(column);
+                }
+            }
+        }
+
+        vector<optional<double>> route_times(from.size() * to.size());
+        for (const auto& [component_id, component] : components) {
+            if (component.targets.empty()) continue;
+            const graph::RouterEngine<double>::WeightMatrix matrix =
+                router_ptr_->BuildWeightMatrix(component.sources, component.targets);
+            for (size_t i = 0; i < component.rows.size(); ++i) {
+                for (size_t j = 0; j < component.columns.size(); ++j) {
+                    route_times[component.rows[i] * to.size() + component.columns[j]] =
+                        matrix[i * component.columns.size() + j];
+                }
+            }
+        }
+        return route_times;
+    }
+
+    std::vector<std::pair<std::string_view, double>> Router::GetReachableStops(const Stop* from,
+        double max_time) const {
+        vector<pair<string_view, double>> stops;
+        for (const auto& [vertex, weight] : graph::FindVerticesWithin(graph_, GetStopVertex(from), max_time)) {
+            if (const string* name = vertex_stop_names_[vertex]) {
+                stops.emplace_back(*name, weight);
+            }
+        }
+        sort(stops.begin(), stops.end(), [](const auto& lhs, const auto& rhs) {
+            return lhs.second != rhs.second ? lhs.second < rhs.second : lhs.first < rhs.first;
+        });
+        return stops;
+    }
+
+    size_t Router::UpdateRoadDistances(const Catalogue& tcat) {
+        graph::DirectedWeightedGraph<double> distance_graph = BuildDistanceGraph(tcat);
+        bool same_edges = distance_graph.GetVertexCount() == graph_.GetVertexCount()
+            && distance_graph.GetEdgeCount() == graph_.GetEdgeCount();
+        unordered_map<graph::EdgeId, double> previous_weights;
+        for (graph::EdgeId edge_id = 0; same_edges && edge_id < graph_.GetEdgeCount(); ++edge_id) {
+            const graph::Edge<double>& edge = distance_graph.GetEdge(edge_id);
+            const graph::Edge<double>& current_edge = graph_.GetEdge(edge_id);
+            if (edge.from != current_edge.from || edge.to != current_edge.to
+                || edge.name_id != current_edge.name_id || edge.quality != current_edge.quality) {
+                same_edges = false;
+            }
+            else if (edge.weight != edge_distances_[edge_id]) {
+                previous_weights.emplace(edge_id, current_edge.weight);
+                edge_distances_[edge_id] = edge.weight;
+            }
+        }
+
+        RoutingData routing_data;
+        for (const StopId stop : tcat.GetSortedStops()) {
+            routing_data.stop_coordinates[string(tcat.GetStopName(stop))] = tcat.GetStopCoordinates(stop);
+        }
+        if (!same_edges) {
+            // Another bus won a pair of collapsed parallel edges, the new graph replaces the old one
+            routing_data.edge_distances.reserve(distance_graph.GetEdgeCount());
+            for (graph::EdgeId edge_id = 0; edge_id < distance_graph.GetEdgeCount(); ++edge_id) {
+                routing_data.edge_distances.push_back(distance_graph.GetEdge(edge_id).weight);
+            }
+            graph_ = move(distance_graph);
+            BuildRouter(move(routing_data));
+            return graph_.GetEdgeCount();
+        }
+        if (previous_weights.empty()) {
+            return 0;
+        }
+        for (const auto& [edge_id, previous_weight] : previous_weights) {
+            graph_.SetEdgeWeight(edge_id, GetEdgeWeight(edge_id, bus_wait_time_, bus_velocity_));
+        }
+        customizations_.clear();
+        if (!router_ptr_->UpdateEdgeWeights(previous_weights)) {
+            routing_data.edge_distances = edge_distances_;
+            routing_data.vertex_components = vertex_components_;
+            BuildRouter(move(routing_data));
+        }
+        return previous_weights.size();
     }
 
     size_t Router::GetGraphVertexCount() {
@@ -127,16 +500,251 @@ namespace transport {
         return graph_;
     }
 
+    const graph::Router<double>* Router::GetRouter() const {
+        return dynamic_cast<const graph::Router<double>*>(router_ptr_.get());
+    }
+
+    const graph::ContractionRouter<double>* Router::GetContractionRouter() const {
+        return dynamic_cast<const graph::ContractionRouter<double>*>(router_ptr_.get());
+    }
+
+    const graph::HubLabelRouter<double>* Router::GetHubLabelRouter() const {
+        return dynamic_cast<const graph::HubLabelRouter<double>*>(router_ptr_.get());
+    }
+
+    const std::vector<graph::ComponentId>& Router::GetVertexComponents() const {
+        return vertex_components_;
+    }
+
+    const std::vector<double>& Router::GetEdgeDistances() const {
+        return edge_distances_;
+    }
+
     json::Node Router::GetSettings() const {
+        string routing_engine = "all_pairs"s;
+        if (routing_engine_ == RoutingEngine::DIJKSTRA) routing_engine = "dijkstra"s;
+        else if (routing_engine_ == RoutingEngine::CONTRACTION_HIERARCHIES) routing_engine = "contraction_hierarchies"s;
+        else if (routing_engine_ == RoutingEngine::HUB_LABELS) routing_engine = "hub_labels"s;
+        else if (routing_engine_ == RoutingEngine::BIDIRECTIONAL_DIJKSTRA) routing_engine = "bidirectional_dijkstra"s;
         return json::Node(json::Dict{
             {{"bus_wait_time"s},{bus_wait_time_}},
-            {{"bus_velocity"s},{bus_velocity_}}
+            {{"bus_velocity"s},{bus_velocity_}},
+            {{"routing_engine"s},{routing_engine}},
+            {{"route_cache_megabytes"s},{route_cache_megabytes_}},
+            {{"route_table_builder"s},{route_table_builder_ == graph::RouteTableBuilder::DIJKSTRA
+                ? "dijkstra"s : "floyd_warshall"s}},
+            {{"route_table_threads"s},{route_table_threads_}},
+            {{"collapse_parallel_edges"s},{collapse_parallel_edges_}},
+            {{"graph_model"s},{graph_model_ == GraphModel::LINEAR ? "linear"s : "stop_pairs"s}},
+            {{"graph_build_threads"s},{graph_build_threads_}},
+            {{"hub_label_order"s},{hub_label_order_ == graph::HubOrder::CONTRACTION
+                ? "contraction"s : "sampled_paths"s}},
+            {{"astar"s},{astar_}},
+            {{"vertex_order"s},{vertex_order_ == VertexOrder::HILBERT ? "hilbert"s : "by_name"s}}
             });
     }
 
     void Router::SetSettings(const json::Node& settings_node) {
-        bus_wait_time_ = settings_node.AsDict().at("bus_wait_time"s).AsInt();
-        bus_velocity_ = settings_node.AsDict().at("bus_velocity"s).AsDouble();
+        const json::Dict& settings_map = settings_node.AsDict();
+        bus_wait_time_ = settings_map.at("bus_wait_time"s).AsInt();
+        bus_velocity_ = settings_map.at("bus_velocity"s).AsDouble();
+        if (settings_map.count("routing_engine"s)) {
+            const string& engine = settings_map.at("routing_engine"s).AsString();
+            if (engine == "all_pairs"s) routing_engine_ = RoutingEngine::ALL_PAIRS;
+            else if (engine == "dijkstra"s) routing_engine_ = RoutingEngine::DIJKSTRA;
+            else if (engine == "contraction_hierarchies"s) routing_engine_ = RoutingEngine::CONTRACTION_HIERARCHIES;
+            else if (engine == "hub_labels"s) routing_engine_ = RoutingEngine::HUB_LABELS;
+            else if (engine == "bidirectional_dijkstra"s) routing_engine_ = RoutingEngine::BIDIRECTIONAL_DIJKSTRA;
+            else throw std::invalid_argument("Unknown routing engine: "s + engine);
+        }
+        if (settings_map.count("route_cache_megabytes"s)) {
+            route_cache_megabytes_ = settings_map.at("route_cache_megabytes"s).AsInt();
+        }
+        if (settings_map.count("route_table_builder"s)) {
+            const string& builder = settings_map.at("route_table_builder"s).AsString();
+            if (builder == "floyd_warshall"s) route_table_builder_ = graph::RouteTableBuilder::FLOYD_WARSHALL;
+            else if (builder == "dijkstra"s) route_table_builder_ = graph::RouteTableBuilder::DIJKSTRA;
+            else throw std::invalid_argument("Unknown route table builder: "s + builder);
+        }
+        if (settings_map.count("route_table_threads"s)) {
+            route_table_threads_ = settings_map.at("route_table_threads"s).AsInt();
+        }
+        if (settings_map.count("collapse_parallel_edges"s)) {
+            collapse_parallel_edges_ = settings_map.at("collapse_parallel_edges"s).AsBool();
+        }
+        if (settings_map.count("graph_model"s)) {
+            const string& model = settings_map.at("graph_model"s).AsString();
+            if (model == "stop_pairs"s) graph_model_ = GraphModel::STOP_PAIRS;
+            else if (model == "linear"s) graph_model_ = GraphModel::LINEAR;
+            else throw std::invalid_argument("Unknown graph model: "s + model);
+        }
+        if (settings_map.count("graph_build_threads"s)) {
+            graph_build_threads_ = settings_map.at("graph_build_threads"s).AsInt();
+        }
+        if (settings_map.count("hub_label_order"s)) {
+            const string& order = settings_map.at("hub_label_order"s).AsString();
+            if (order == "sampled_paths"s) hub_label_order_ = graph::HubOrder::SAMPLED_PATHS;
+            else if (order == "contraction"s) hub_label_order_ = graph::HubOrder::CONTRACTION;
+            else throw std::invalid_argument("Unknown hub label order: "s + order);
+        }
+        if (settings_map.count("astar"s)) {
+            astar_ = settings_map.at("astar"s).AsBool();
+        }
+        if (settings_map.count("vertex_order"s)) {
+            const string& order = settings_map.at("vertex_order"s).AsString();
+            if (order == "by_name"s) vertex_order_ = VertexOrder::BY_NAME;
+            else if (order == "hilbert"s) vertex_order_ = VertexOrder::HILBERT;
+            else throw std::invalid_argument("Unknown vertex order: "s + order);
+        }
+    }
+
+    // A router built without the catalogue ids finds stops by names
+    graph::VertexId Router::GetStopVertex(const Stop* stop) const {
+        return stop->id < stop_vertices_.size() ? stop_vertices_[stop->id] : stop_ids_.at(stop->name);
+    }
+
+    void Router::BuildRouter(RoutingData&& routing_data) {
+        vertex_stop_names_.assign(graph_.GetVertexCount(), nullptr);
+        for (const auto& [name, vertex] : stop_ids_) {
+            vertex_stop_names_.at(vertex) = &name;
+        }
+        if (routing_data.edge_distances.size() == graph_.GetEdgeCount()) {
+            edge_distances_ = move(routing_data.edge_distances);
+            for (graph::EdgeId edge_id = 0; edge_id < graph_.GetEdgeCount(); ++edge_id) {
+                graph_.SetEdgeWeight(edge_id, GetEdgeWeight(edge_id, bus_wait_time_, bus_velocity_));
+            }
+        }
+        else {
+            // A graph without distances keeps its weights, the distances are found from them
+            edge_distances_.clear();
+            edge_distances_.reserve(graph_.GetEdgeCount());
+            for (graph::EdgeId edge_id = 0; edge_id < graph_.GetEdgeCount(); ++edge_id) {
+                const graph::Edge<double>& edge = graph_.GetEdge(edge_id);
+                edge_distances_.push_back(IsWaitEdge(edge) ? 0.0 : edge.weight * bus_velocity_ * (100.0 / 6.0));
+            }
+        }
+        customizations_.clear();
+        if (routing_data.vertex_components.size() == graph_.GetVertexCount()) {
+            vertex_components_ = move(routing_data.vertex_components);
+        }
+        else {
+            vertex_components_ = graph::FindComponents(graph_);
+        }
+        switch (routing_engine_) {
+        case RoutingEngine::ALL_PAIRS:
+            if (routing_data.routes_internal_data) {
+                router_ptr_ = make_unique<graph::Router<double>>(graph_, vertex_components_,
+                    move(*routing_data.routes_internal_data));
+            }
+            else {
+                router_ptr_ = make_unique<graph::Router<double>>(graph_, vertex_components_, route_table_builder_,
+                    static_cast<size_t>(max(route_table_threads_, 0)));
+            }
+            break;
+        case RoutingEngine::DIJKSTRA:
+            if (astar_) {
+                router_ptr_ = make_unique<graph::LazyRouter<double>>(graph_,
+                    GetVertexPoints(routing_data.stop_coordinates));
+            }
+            else {
+                router_ptr_ = make_unique<graph::LazyRouter<double>>(graph_,
+                    static_cast<size_t>(route_cache_megabytes_) << 20);
+            }
+            break;
+        case RoutingEngine::CONTRACTION_HIERARCHIES:
+            if (routing_data.hierarchy_data) {
+                router_ptr_ = make_unique<graph::ContractionRouter<double>>(graph_, move(*routing_data.hierarchy_data));
+            }
+            else {
+                router_ptr_ = make_unique<graph::ContractionRouter<double>>(graph_);
+            }
+            break;
+        case RoutingEngine::HUB_LABELS:
+            if (routing_data.label_data) {
+                router_ptr_ = make_unique<graph::HubLabelRouter<double>>(graph_, move(*routing_data.label_data));
+            }
+            else {
+                router_ptr_ = make_unique<graph::HubLabelRouter<double>>(graph_, hub_label_order_);
+            }
+            break;
+        case RoutingEngine::BIDIRECTIONAL_DIJKSTRA:
+            router_ptr_ = make_unique<graph::BidirectionalRouter<double>>(graph_);
+            break;
+        }
+    }
+
+    // Waiting is the only edge between two stop vertices without spans: it leads from the stop's
+    // arrival vertex to its departure vertex
+    bool Router::IsWaitEdge(const graph::Edge<double>& edge) const {
+        const graph::VertexId stop_vertex_count = stop_ids_.size() * 2;
+        return edge.from < stop_vertex_count && edge.to < stop_vertex_count && edge.quality == 0;
+    }
+
+    double Router::GetEdgeWeight(graph::EdgeId edge_id, int bus_wait_time, double bus_velocity) const {
+        if (IsWaitEdge(graph_.GetEdge(edge_id))) {
+            return static_cast<double>(bus_wait_time);
+        }
+        return edge_distances_[edge_id] / (bus_velocity * (100.0 / 6.0));
+    }
+
+    // Customization is one pass over the edges and two frozen copies for the search, no preprocessing
+    const Router::Customization* Router::GetCustomization(const RouteParameters& parameters) const {
+        const int bus_wait_time = parameters.bus_wait_time.value_or(bus_wait_time_);
+        const double bus_velocity = parameters.bus_velocity.value_or(bus_velocity_);
+        if (bus_wait_time == bus_wait_time_ && bus_velocity == bus_velocity_) {
+            return nullptr;
+        }
+        if (bus_wait_time < 0 || bus_velocity <= 0.0) {
+            throw std::invalid_argument("Wait time should be non-negative and velocity positive");
+        }
+        for (const auto& customization : customizations_) {
+            if (customization->bus_wait_time == bus_wait_time && customization->bus_velocity == bus_velocity) {
+                return customization.get();
+            }
+        }
+        if (customizations_.size() == MAX_CUSTOMIZATIONS) {
+            customizations_.pop_front();
+        }
+        auto customization = make_unique<Customization>(Customization{ bus_wait_time, bus_velocity, graph_, nullptr });
+        for (graph::EdgeId edge_id = 0; edge_id < graph_.GetEdgeCount(); ++edge_id) {
+            customization->graph.SetEdgeWeight(edge_id, GetEdgeWeight(edge_id, bus_wait_time, bus_velocity));
+        }
+        customization->router = make_unique<graph::BidirectionalRouter<double>>(customization->graph);
+        customizations_.push_back(move(customization));
+        return customizations_.back().get();
+    }
+
+    // Stops go to the unit sphere, so the straight line between two of them is a chord
+    // no longer than the arc. On-board vertices of the linear model take the point of the stop
+    // they are boarded from or alighted at, a vertex without a stop stays at the center.
+    std::vector<graph::LazyRouter<double>::Point> Router::GetVertexPoints(
+        const std::map<std::string, geo::Coordinates>& stop_coordinates) const {
+        const double degree = 3.1415926535 / 180.0;
+        const size_t vertex_count = graph_.GetVertexCount();
+        vector<graph::LazyRouter<double>::Point> points(vertex_count, { 0.0, 0.0, 0.0 });
+        vector<bool> placed(vertex_count, false);
+        for (const auto& [stop_name, vertex_id] : stop_ids_) {
+            const auto it = stop_coordinates.find(stop_name);
+            if (it == stop_coordinates.end()) continue;
+            const double lat = it->second.lat * degree;
+            const double lng = it->second.lng * degree;
+            const graph::LazyRouter<double>::Point point{ cos(lat) * cos(lng), cos(lat) * sin(lng), sin(lat) };
+            points[vertex_id] = points[vertex_id + 1] = point;
+            placed[vertex_id] = placed[vertex_id + 1] = true;
+        }
+        const graph::VertexId stop_vertex_count = stop_ids_.size() * 2;
+        for (graph::EdgeId edge_id = 0; edge_id < graph_.GetEdgeCount(); ++edge_id) {
+            const graph::Edge<double>& edge = graph_.GetEdge(edge_id);
+            if (edge.from < stop_vertex_count && edge.to >= stop_vertex_count && !placed[edge.to]) {
+                points[edge.to] = points[edge.from];
+                placed[edge.to] = placed[edge.from];
+            }
+            else if (edge.to < stop_vertex_count && edge.from >= stop_vertex_count && !placed[edge.from]) {
+                points[edge.from] = points[edge.to];
+                placed[edge.from] = placed[edge.to];
+            }
+        }
+        return points;
     }
 
 } // namespace transport
\ No newline at end of file
@@ -4,14 +4,69 @@
 #include "json_builder.h"
 #include "transport_catalogue.h"
 #include "graph.h"
+#include "graph_components.h"
 #include "router.h"
-
+#include "bounded_search.h"
+#include "lazy_router.h"
+#include "bidirectional_router.h"
+#include "contraction_router.h"
+#include "hub_label_router.h"
+#include "geo.h"
+
+#include <deque>
+#include <memory>
 #include <optional>
 #include <string>
 #include <string_view>
+#include <utility>
+#include <vector>
 
 namespace transport {
 
+    enum class RoutingEngine {
+        ALL_PAIRS,
+        DIJKSTRA,
+        CONTRACTION_HIERARCHIES,
+        HUB_LABELS,
+        BIDIRECTIONAL_DIJKSTRA
+    };
+
+    // Engine data loaded from the base, so that process_requests doesn't compute it again
+    struct RoutingData {
+        std::optional<graph::Router<double>::RoutesInternalData> routes_internal_data;
+        std::optional<graph::ContractionRouter<double>::HierarchyData> hierarchy_data;
+        std::optional<graph::HubLabelRouter<double>::LabelData> label_data;
+        // Found again when it doesn't match the graph
+        std::vector<graph::ComponentId> vertex_components;
+        // Road distance of every edge in meters, 0 for waiting, boarding and alighting.
+        // Recovered from the weights when it doesn't match the graph.
+        std::vector<double> edge_distances;
+        // Places the vertices for the A* bound of "dijkstra"
+        std::map<std::string, geo::Coordinates> stop_coordinates;
+        // Arrival vertex by catalogue stop id
+        std::vector<graph::VertexId> stop_vertices;
+    };
+
+    // STOP_PAIRS adds a ride edge for every pair of stops of a bus, O(n^2) per bus.
+    // LINEAR threads every bus through a chain of on-board vertices, O(n) per bus.
+    enum class GraphModel {
+        STOP_PAIRS,
+        LINEAR
+    };
+
+    // Order of the stop vertices. BY_NAME follows the names. HILBERT follows a Hilbert curve over
+    // the coordinates, so stops close on the map get close vertex ids and rows of the route table.
+    enum class VertexOrder {
+        BY_NAME,
+        HILBERT
+    };
+
+    // Routing settings a single request may override, the graph and the base stay as they are
+    struct RouteParameters {
+        std::optional<int> bus_wait_time;
+        std::optional<double> bus_velocity;
+    };
+
     class Router {
     public:
         Router() = default;
@@ -23,13 +78,29 @@ namespace transport {
             std::map<std::string, graph::VertexId> stop_ids);
 
         void SetGraph(graph::DirectedWeightedGraph<double>&& graph,
-            std::map<std::string, graph::VertexId>&& stop_ids);
+            std::map<std::string, graph::VertexId>&& stop_ids,
+            RoutingData&& routing_data = {});
 
         const graph::DirectedWeightedGraph<double>& BuildGraph(const Catalogue& tcat);
 
-        json::Array GetEdgesItems(const std::vector<graph::EdgeId>& edges) const;
+        json::Array GetEdgesItems(const std::vector<graph::EdgeId>& edges,
+            const RouteParameters& parameters = {}) const;
 
-        std::optional<graph::Router<double>::RouteInfo> GetRouteInfo(const Stop* from, const Stop* to) const;
+        // Overridden parameters are answered on a reweighted copy of the graph by a bidirectional search
+        std::optional<graph::Router<double>::RouteInfo> GetRouteInfo(const Stop* from, const Stop* to,
+            const RouteParameters& parameters = {}) const;
+
+        // Row-major from x to, nullopt without a route or for a null stop
+        std::vector<std::optional<double>> GetRouteTimes(const std::vector<const Stop*>& from,
+            const std::vector<const Stop*>& to) const;
+
+        // Stops reachable from a stop within max_time, sorted by arrival time, then by name
+        std::vector<std::pair<std::string_view, double>> GetReachableStops(const Stop* from, double max_time) const;
+
+        // Call after road distances changed in the catalogue of the graph. The edges of the changed
+        // distances get new weights and the engine repairs only what they affect, if it can,
+        // otherwise it is built again. Returns the number of edges whose distance changed.
+        size_t UpdateRoadDistances(const Catalogue& tcat);
 
         size_t GetGraphVertexCount();
 
@@ -37,22 +108,76 @@ namespace transport {
 
         const graph::DirectedWeightedGraph<double>& GetGraph() const;
 
-        json::Node GetSettings() const;
+        const graph::Router<double>* GetRouter() const;
+
+        const graph::ContractionRouter<double>* GetContractionRouter() const;
 
-        ~Router() {
-            delete router_ptr_;
-        }
+        const graph::HubLabelRouter<double>* GetHubLabelRouter() const;
+
+        const std::vector<graph::ComponentId>& GetVertexComponents() const;
+
+        const std::vector<double>& GetEdgeDistances() const;
+
+        json::Node GetSettings() const;
 
     private:
         int bus_wait_time_ = 0;
         double bus_velocity_ = 0;
+        RoutingEngine routing_engine_ = RoutingEngine::ALL_PAIRS;
+        int route_cache_megabytes_ = 64;
+        graph::RouteTableBuilder route_table_builder_ = graph::RouteTableBuilder::FLOYD_WARSHALL;
+        int route_table_threads_ = 0;
+        bool collapse_parallel_edges_ = false;
+        GraphModel graph_model_ = GraphModel::STOP_PAIRS;
+        int graph_build_threads_ = 0;
+        graph::HubOrder hub_label_order_ = graph::HubOrder::SAMPLED_PATHS;
+        bool astar_ = false;
+        VertexOrder vertex_order_ = VertexOrder::BY_NAME;
 
         graph::DirectedWeightedGraph<double> graph_;
         std::map<std::string, graph::VertexId> stop_ids_;
-
-        graph::Router<double>* router_ptr_ = nullptr;
+        // Arrival vertex by catalogue stop id, requests find stops here instead of stop_ids_
+        std::vector<graph::VertexId> stop_vertices_;
+        // Stop name by vertex, nullptr for the vertices that aren't stops
+        std::vector<const std::string*> vertex_stop_names_;
+        // No route leads from one component to another
+        std::vector<graph::ComponentId> vertex_components_;
+
+        std::unique_ptr<graph::RouterEngine<double>> router_ptr_;
+
+        // The graph is built with road distances, weights in minutes are applied to a copy of them
+        std::vector<double> edge_distances_;
+
+        // Graph with the weights of other parameters, only edge weights differ from graph_
+        struct Customization {
+            int bus_wait_time;
+            double bus_velocity;
+            graph::DirectedWeightedGraph<double> graph;
+            std::unique_ptr<graph::BidirectionalRouter<double>> router;
+        };
+        static constexpr size_t MAX_CUSTOMIZATIONS = 4;
+        // The oldest one is dropped first
+        mutable std::deque<std::unique_ptr<Customization>> customizations_;
 
         void SetSettings(const json::Node& settings_node);
+        graph::DirectedWeightedGraph<double> BuildDistanceGraph(const Catalogue& tcat);
+        void AddStopPairRides(graph::DirectedWeightedGraph<double>& stops_graph, const Catalogue& tcat,
+            const std::vector<BusId>& buses);
+        std::vector<graph::Edge<double>> GetStopPairRides(const Catalogue& tcat, BusId bus,
+            graph::NameId bus_name_id) const;
+        void AddBusChains(graph::DirectedWeightedGraph<double>& stops_graph, const Catalogue& tcat,
+            const std::vector<BusId>& buses);
+        static std::vector<std::pair<size_t, size_t>> GetRideSegments(const Catalogue& tcat, BusId bus);
+        std::vector<StopId> GetStopOrder(const Catalogue& tcat) const;
+        static graph::DirectedWeightedGraph<double> SortEdgesByTail(const graph::DirectedWeightedGraph<double>& graph);
+        void BuildRouter(RoutingData&& routing_data = {});
+        graph::VertexId GetStopVertex(const Stop* stop) const;
+        bool IsWaitEdge(const graph::Edge<double>& edge) const;
+        double GetEdgeWeight(graph::EdgeId edge_id, int bus_wait_time, double bus_velocity) const;
+        // nullptr when the parameters don't differ from the settings
+        const Customization* GetCustomization(const RouteParameters& parameters) const;
+        std::vector<graph::LazyRouter<double>::Point> GetVertexPoints(
+            const std::map<std::string, geo::Coordinates>& stop_coordinates) const;
     };
 
 } // namespace transport
\ No newline at end of file